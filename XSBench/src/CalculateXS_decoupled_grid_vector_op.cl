@@ -8,15 +8,17 @@ __kernel void calculate_macro_xs(int lookups,
 				__global double16 *restrict nuclide_grids)
 {
 	for(int i = 0; i < lookups; i++) {
-		Meta iter_meta = read_channel_altera(MAT_QUEUE);
+		Meta iter_meta;
+		read_channel_counted(STAT_MAT_IN, MAT_QUEUE, iter_meta);
 		int iter_num = iter_meta.iter_num;
 		write_channel_altera(MAT_ACCU_QUEUE, iter_meta);
 		for( int j = 0; j < iter_num; j++ )
 		{
-			int2 addr = read_channel_altera(ADDR_QUEUE);
+			int2 addr;
+			read_channel_counted(STAT_ADDR_IN, ADDR_QUEUE, addr);
 			double16 nu_data = nuclide_grids[addr.s0];
 			nu_data.sf = concs[addr.s1].d;
-			write_channel_altera(NU_QUEUE, nu_data);
+			write_channel_counted(STAT_NU_OUT, NU_QUEUE, nu_data);
 		}
 	}
 }
@@ -33,7 +35,8 @@ __kernel void accumulate_macro_xs(int lookups,
 		float macro_xs_vector[5] = {0.0f};
 		for(int j = 0; j < iter_num; j++) 
 		{
-			double16 nu_data = read_channel_altera(NU_QUEUE);	
+			double16 nu_data;
+			read_channel_counted(STAT_NU_IN, NU_QUEUE, nu_data);
 			double8 low = nu_data.lo;
 			double8 high = nu_data.hi;
 
@@ -18,7 +18,8 @@ __kernel void grid_search(int lookups, __global GridPoint_Array *restrict A) {
 	__local GridPoint_Array d;
 	__local GridPoint_Array d_tmp;
 	for (int i = 0; i < lookups; i++) {
-	    	SearchContext ct = read_channel_altera(SC_QUEUE1);
+	    	SearchContext ct;
+	    	read_channel_counted(STAT_SC_IN, SC_QUEUE1, ct);
 	    	int mat = ct.mat;
 	    	double p_energy = ct.energy;
 		long mid;
@@ -37,7 +38,7 @@ __kernel void grid_search(int lookups, __global GridPoint_Array *restrict A) {
 		int iter_num = num_nucs[mat];
 		int start_idx = cumulative_nucs[mat];
 		Meta meta = {p_energy, iter_num, mat};
-		write_channel_altera(MAT_QUEUE, meta);
+		write_channel_counted(STAT_MAT_OUT, MAT_QUEUE, meta);
 		for( int j = 0; j < iter_num; j++ )
 		{
 			int tmp = start_idx + j;
@@ -45,7 +46,7 @@ __kernel void grid_search(int lookups, __global GridPoint_Array *restrict A) {
 			int energy_at_nuc = (int) d_tmp.xs_ptrs[p_nuc]; 
 			int nu_idx = p_nuc * n_gridpoints + energy_at_nuc;
 			int2 addr = (int2) (nu_idx, tmp);
-			write_channel_altera(ADDR_QUEUE, addr);
+			write_channel_counted(STAT_ADDR_OUT, ADDR_QUEUE, addr);
 		}
   	}
 }
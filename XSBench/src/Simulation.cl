@@ -3,6 +3,7 @@
 
 #include "DataTypes.h"
 #include "bscache.cl"
+#include "debug.cl"
 
 #define STAGE_NUM 10
 #define SIZE 12
@@ -100,7 +101,7 @@ __kernel void simulation(int lookups)
 		}
 
 		SearchContext sc = {p_energy, ll, ul, mat};
-		write_channel_altera(SC_QUEUE1, sc);
+		write_channel_counted(STAT_SC_OUT, SC_QUEUE1, sc);
     }
 }
 
@@ -26,9 +26,56 @@
  */
 #define SAMPLE_DEPTH 2000
 
+/* Store time stamps as 16-bit deltas from the previous stamp, packed four to a trace buffer word. 
+ * A delta of 2^15 cycles or more is stored as an escape of four 16-bit slots holding the absolute 
+ * stamp. This gives up to 4x the trace depth in the same on-chip memory, cyclic recording is not 
+ * supported and stops when the buffer is full 
+ */
+#define DELTA_STAMPS 0
+
+/* Store the 32-bit payload of each snapshot next to its time stamp, read back with D_READ_PAYLOAD. 
+ * take_snapshot records the low 16 bits of its input, take_snapshot_value a full 32-bit value. Costs 
+ * 4 bytes of on-chip memory per sample, payloads are not kept with DELTA_STAMPS or D_RECORD_STREAM. 
+ * Off by default, enable it for kernels that call take_snapshot_value. Without it D_READ_PAYLOAD 
+ * reads a 0 header 
+ */
+#define SNAPSHOT_PAYLOAD 0
+
+/* Number of log2 spaced bins of the D_HISTOGRAM interval histogram. Bin 0 counts zero intervals, 
+ * bin b counts intervals in [2^(b-1), 2^b) cycles. The histogram is read as the number of 
+ * intervals, HISTOGRAM_BINS counters and the longest interval 
+ */
+#define HISTOGRAM_BINS 64
+
 /* Number of tags and timestamps stored for a watch point */
 #define WATCH_SAMPLE_DEPTH 8
 
+/* Number of saturating hit counters per watch point. A range or mask watch point splits the 
+ * watched addresses into regions of 2^region_shift bytes, hits beyond the last region are 
+ * counted in the last region 
+ */
+#define WATCH_REGIONS 64
+
+/* Number of channel ends instrumented with write_channel_counted and read_channel_counted. Each 
+ * counts its transfers, the cycles they were blocked and the longest block. Set the variable to 
+ * zero to compile the wrappers as the plain blocking channel calls 
+ */
+#define NUM_CHANNEL_STATS 0
+
+/* Channel stats of the lookup pipeline, both ends of each queue between the kernels. Counted 
+ * with NUM_CHANNEL_STATS 8, the polling wrappers slow the stages so it is off by default */
+#define STAT_SC_OUT   0
+#define STAT_SC_IN    1
+#define STAT_MAT_OUT  2
+#define STAT_MAT_IN   3
+#define STAT_ADDR_OUT 4
+#define STAT_ADDR_IN  5
+#define STAT_NU_OUT   6
+#define STAT_NU_IN    7
+
+/* Words read per channel stat : transfers, blocked cycles, longest block */
+#define CHANNEL_STAT_WORDS 3
+
 /* Keeping the depth of channels as 16,however, this will be optimized by AOCL */
 #define DEBUG_CHANNEL_DEPTH 4
 
@@ -38,6 +85,13 @@
 /* Start sampling automatically, default state after reset can be set here */
 #define DEFAULT_WATCH_SAMPLING_SCHEME D_RECORD
 
+/* Trace buffer id passed to read_stamp to address every trace buffer in a single launch */
+#define ALL_DEBUG_POINTS 0xFFFFFFFF
+
+/* read_stamp and read_watch take a 32-bit mask of the buffers a command is sent to */
+#define DEBUG_POINTS_MASK ((uint) ((1ul << NUM_DEBUG_POINTS) - 1))
+#define WATCH_POINTS_MASK ((uint) ((1ul << NUM_WATCH_POINTS) - 1))
+
 
 #define PACKED_AGGREGATE __attribute__((aligned (1))) __attribute__((packed))
 
@@ -49,9 +103,52 @@ typedef enum {D_RESET,        //Reset the trace buffer
               D_RECORD,        //Start storing the data in trace buffer, stop after depth : FIXME 
               D_RECORD_CYCLIC, //Store the data in trace buffer in a cyclic buffer
               D_STOP,         //Stop Storing the data     
-              D_READ          //Read the data from trace buffer to host
+              D_READ,         //Read the data from trace buffer to host
+              D_RECORD_STREAM,//Stream the trace buffer to host memory while recording
+              D_HISTOGRAM,    //Bin the interval between stamps into a log2 histogram
+              D_READ_HISTOGRAM,//Read the histogram to host
+              D_TRIGGER,      //Record cyclically until the trigger fires, then stop after the post-trigger samples
+              D_READ_PAYLOAD, //Read the payloads of the recorded samples to host, laid out like D_READ
+              D_READ_COUNTERS,//Read the live counters to host, recording continues
+              D_RESET_COUNTERS//Clear the live counters, recording continues
              } debug_command_e; 
 
+/* Live counters kept by every trace buffer whatever its state, read with D_READ_COUNTERS as the 
+ * number of snapshots, the shortest, longest and summed interval between snapshots in cycles and 
+ * the number of samples lost to a full trace buffer, an overwrite or a stalled stream */
+#define LIVE_COUNTER_WORDS 5
+
+/* Condition that fires an armed trigger, checked on every take_snapshot. The value is compared with 
+ * the snapshot payload, the interval with the cycles since the previous snapshot */
+typedef enum {T_EQUAL,        //Payload equal to value
+              T_ABOVE,        //Payload equal to or above value
+              T_INTERVAL      //More than interval cycles since the previous snapshot
+             } trigger_mode_e; 
+
+typedef struct PACKED_AGGREGATE 
+               { unsigned int   value; 
+                 unsigned int   interval; 
+                 unsigned short pre; 
+                 unsigned short post; 
+                 unsigned char  mode; 
+               } trigger_cfg_s;
+
+/* Snapshots a trace buffer keeps while recording, D_HISTOGRAM always sees every snapshot. With 
+ * S_RANDOM a 16-bit LFSR keeps one snapshot in every on average, every rounded up to a power of two */
+typedef enum {S_EVERY,        //Keep every every-th snapshot, 0 or 1 keeps all of them
+              S_RANDOM        //Keep a pseudo-random subset of the snapshots
+             } sampling_mode_e; 
+
+typedef struct PACKED_AGGREGATE 
+               { unsigned short every; 
+                 unsigned char  mode; 
+               } sampling_cfg_s;
+
+/* The first word of a trace buffer read holds the number of valid samples. A buffer recorded with 
+ * D_TRIGGER also holds the position of the trigger sample + 1 in bits 32 to 47, 0 if it did not fire */
+#define TRACE_COUNT(header)    ((header) & 0xFFFFFFFF)
+#define TRACE_TRIGGER(header)  (((header) >> 32) & 0xFFFF)
+
 /* Not all the 64-bits of timer need to be stored, making it a 40-bit storage  would save M20 blocks */
 typedef struct PACKED_AGGREGATE
                { unsigned char hi; 
@@ -63,6 +160,23 @@ typedef struct PACKED_AGGREGATE
                  unsigned short tag; 
                } watch_s;
 
+/* Address match of a watch point */
+typedef enum {W_EXACT,        //Address equal to base
+              W_RANGE,        //Address in [base, limit)
+              W_MASK          //Address equal to base in the bits set in limit
+             } watch_mode_e; 
+
+typedef struct PACKED_AGGREGATE 
+               { unsigned int   base; 
+                 unsigned int   limit; 
+                 unsigned char  mode; 
+                 unsigned char  region_shift; 
+               } watch_cfg_s;
+
+/* A watch point is read as its base, the number of samples, WATCH_SAMPLE_DEPTH samples and 
+ * WATCH_REGIONS hit counters in addr with the region number in tag */
+#define WATCH_READ_DEPTH (WATCH_SAMPLE_DEPTH + 2 + WATCH_REGIONS)
+
 #if SAMPLE_DEPTH <= 512  
 #define DEBUG_SAMPLE_DEPTH 512
 #elif SAMPLE_DEPTH <= 1024
@@ -73,11 +187,31 @@ typedef struct PACKED_AGGREGATE
 #define DEBUG_SAMPLE_DEPTH 2048
 #endif
 
+/* Number of samples per trace buffer as seen by the host after decoding */
+#if DELTA_STAMPS
+#define DEBUG_TRACE_DEPTH (4*DEBUG_SAMPLE_DEPTH)
+#else 
+#define DEBUG_TRACE_DEPTH DEBUG_SAMPLE_DEPTH
+#endif
+
+/* In D_RECORD_STREAM the trace buffer is split into two halves, a full half is flushed to host 
+ * as one block of a header followed by STREAM_BLOCK_DEPTH time stamps. The header holds the 
+ * number of valid stamps, the number of dropped stamps and a last block flag 
+ */
+#define STREAM_BLOCK_DEPTH (DEBUG_SAMPLE_DEPTH/2)
+
+/* Number of stream_stamp launches the host keeps in flight for a streaming trace buffer */
+#define DEBUG_STREAM_SLICES 2
+
 /* Writes data channel without blocking, this channel is provided to a trace-buffer, which samples  
  * a free running counter and stores the data into a local memory. This memory can be read by host 
  * by launching the kernel read_stamp 
  *  
  * void take_snapshot(uint id, stamp_t in); 
+ *
+ * Same as take_snapshot, the value is kept as the payload of the sample, see SNAPSHOT_PAYLOAD 
+ *
+ * void take_snapshot_value(uint id, uint value); 
  */
 
 /* Add a watchpoint for the given address. Adress is written into a channel without blocking, which is 
@@ -90,6 +224,23 @@ typedef struct PACKED_AGGREGATE
  * void monitor_address(uint id, size_t addr, ushort tag); 
  */
 
+/* Watch every address in [base, base+size) or every address equal to base in the bits set in 
+ * mask, instead of a single address. Each hit also bumps the counter of its region of 
+ * 2^region_shift bytes, e.g. 12 for a 4 KB heat map 
+ *
+ * void add_watch_range(uint id, size_t base, size_t size, uchar region_shift); 
+ *
+ * void add_watch_mask(uint id, size_t base, size_t mask, uchar region_shift); 
+ */
+
+/* Blocking channel calls counted in channel stat id, read by the host with read_channel_stats. The 
+ * wrappers poll the channel without blocking, so the stage runs a little slower while counted 
+ *
+ * write_channel_counted(id, channel, value); 
+ *
+ * read_channel_counted(id, channel, dest); 
+ */
+
 
 
 #endif //DEBUG_DEFINES__H
@@ -199,6 +199,7 @@ int main( int argc, char* argv[] )
 		return false;
 	// init debug
         init_debug(context,program,device,&debug_kernel,&debug_queue);
+	start_monitor_sampler(MONITOR_SAMPLE_HZ, stdout);
 	printf("Init complete!\n");
 
 	// Run simulation
@@ -296,16 +297,17 @@ void run_simulation_d8(Inputs in, double *energy, cl_int8 *energy_grid_xs,
 	cl_event events[K_NUM_KERNELS];
 	// Record start time
 	double time = getCurrentTimestamp();
+	set_monitor_phase("simulation");
 	printf("Start simulation!\n");
-	status = clEnqueueTask(queues[K_SIMULATION], kernels[K_SIMULATION], 0, NULL, NULL);
+	status = clEnqueueTask(queues[K_SIMULATION], kernels[K_SIMULATION], 0, NULL, &events[K_SIMULATION]);
 	checkError(status, "Failed to launch kernel simulation");
-	status = clEnqueueTask(queues[K_GRIDSEARCH], kernels[K_GRIDSEARCH], 0, NULL, NULL);
+	status = clEnqueueTask(queues[K_GRIDSEARCH], kernels[K_GRIDSEARCH], 0, NULL, &events[K_GRIDSEARCH]);
 	checkError(status, "Failed to launch kernel gridsearch");
-	status = clEnqueueTask(queues[K_ADDR_GEN], kernels[K_ADDR_GEN], 0, NULL, NULL);
+	status = clEnqueueTask(queues[K_ADDR_GEN], kernels[K_ADDR_GEN], 0, NULL, &events[K_ADDR_GEN]);
 	checkError(status, "Failed to launch kernel addr_gen");
-	status = clEnqueueTask(queues[K_CAL_MACRO_XS], kernels[K_CAL_MACRO_XS], 0, NULL, NULL);
+	status = clEnqueueTask(queues[K_CAL_MACRO_XS], kernels[K_CAL_MACRO_XS], 0, NULL, &events[K_CAL_MACRO_XS]);
 	checkError(status, "Failed to launch kernel cal_macro_xs");
-	status = clEnqueueTask(queues[K_ACCU_MACRO_XS], kernels[K_ACCU_MACRO_XS], 0, NULL, NULL);
+	status = clEnqueueTask(queues[K_ACCU_MACRO_XS], kernels[K_ACCU_MACRO_XS], 0, NULL, &events[K_ACCU_MACRO_XS]);
 	checkError(status, "Failed to launch kernel accu_macro_xs");
 	status = clEnqueueTask(queues[K_CAL_VHASH], kernels[K_CAL_VHASH], 0, NULL, &events[K_CAL_VHASH]);
 	checkError(status, "Failed to launch kernel cal_vhash");
@@ -324,8 +326,24 @@ void run_simulation_d8(Inputs in, double *energy, cl_int8 *energy_grid_xs,
 	reset_debug_all_buffers(debug_kernel,debug_queue);
 #endif //NUM_DEBUG_POINTS
 
-	// Record execution time
+	// Record execution time, the energy over the profiled span of the pipeline kernels
+	const double joules = events_energy(events, K_NUM_KERNELS);
+	for(int i=0; i<K_NUM_KERNELS; ++i)
+		clReleaseEvent(events[i]);
 	time = getCurrentTimestamp() - time;
+	set_monitor_phase(NULL);
+
+#if NUM_CHANNEL_STATS >= 8
+	//Utilization of the lookup pipeline, ids as in debug_defines.h
+	stamp_t*    channel_stats;
+	const char* channel_names[NUM_CHANNEL_STATS] = {"simulation -> grid_search","grid_search <- simulation",
+	                                                "grid_search -> macro_xs meta","macro_xs <- grid_search meta",
+	                                                "grid_search -> macro_xs addr","macro_xs <- grid_search addr",
+	                                                "macro_xs -> accumulate"   ,"accumulate <- macro_xs"};
+	read_channel_stats(&channel_stats);
+	print_channel_stats(channel_stats,channel_names);
+	reset_channel_stats();
+#endif //NUM_CHANNEL_STATS
 
 	printf("\n" );
 	printf("Simulation complete.\n" );
@@ -356,6 +374,7 @@ void run_simulation_d8(Inputs in, double *energy, cl_int8 *energy_grid_xs,
 	#endif
 
 	printf("\nProcessing time = %.4fms\n", (float)(time * 1E3));
+	print_energy(stdout, joules, time, in.lookups, "lookup");
 }
 
 // Set up the context, device, kernels, and buffers...
@@ -420,6 +439,7 @@ bool init()
 // Free the resources allocated during initialization
 void cleanup()
 {
+  stop_monitor_sampler();
   for(int i=0; i<K_NUM_KERNELS; ++i)
     if(kernels[i]) 
       clReleaseKernel(kernels[i]);  
@@ -234,6 +234,8 @@ double kernel_cpu(int nthreads, int m, int n, float drift, float vol, float S_0,
 
 // free the resources allocated during initialization
 void cleanup() {
+  stop_monitor_sampler();
+
   if(program)
     clReleaseProgram(program);
 
@@ -244,6 +246,8 @@ void cleanup() {
 #else
        clSVMFree(my_context, kernel_result[i]);
 #endif /* USE_SVM_API == 0 */
+     if(e[i])
+       clReleaseEvent(e[i]);
      if(black_scholes[i])
        clReleaseKernel(black_scholes[i]);
      if(mersenne_twister_generate[i])
@@ -287,7 +291,7 @@ void launch_asian_option_computation(
    float sigma, float r,
    float T, float K, float S_0)
 {
-   print_monitor(stdout);
+   set_monitor_phase("asian_option");
    printf("launch_asian_option@%f.\n", getCurrentTimestamp());
    // Precompute parameters on the host
    cl_float delta_t = T / n;
@@ -441,7 +445,11 @@ int main(int argc, char **argv) {
   my_context = clCreateContext(0, num_devices, &device[0], &oclContextCallback, NULL, &status);
   checkError(status,"Failed clCreateContext.");
 
-  print_monitor(stdout);
+  double monitor_hz = MONITOR_SAMPLE_HZ;
+  if(options.has("monitor-hz")) {
+    monitor_hz = options.get<double>("monitor-hz");
+  }
+  start_monitor_sampler(monitor_hz, stdout);
 
   // Create command queues and memory buffers per device
   for (unsigned i=0; i<num_devices; i++) {
@@ -531,6 +539,8 @@ int main(int argc, char **argv) {
   } else {
     for (unsigned i=0; i<num_devices; i++) {
     // In the case of multiple devices, we submit a different problem to each such as looking at different strike prices
+    // Hold back the launch on a board close to its thermal limit rather than let it throttle
+      thermal_pace(i);
       launch_asian_option_computation(i, nr_sims, N, sigma, RISK_FREE_RATE, TIME_HORIZON, (strike_price-i), initial_price );
     }
     for (unsigned i=0; i<num_devices; i++) {
@@ -539,6 +549,7 @@ int main(int argc, char **argv) {
   }
 
   double end = getCurrentTimestamp() * 1.0e+9;
+  set_monitor_phase(NULL);
   for (unsigned i=0; i<num_devices; i++) {
     printf( "DEVICE %d: r=%.2f sigma=%.2f T=%.1f S0=%.1f K=%.1f : Resulting Price is %lf\n", i, RISK_FREE_RATE, sigma, TIME_HORIZON,
        initial_price, (strike_price-i), price[i]);
@@ -549,6 +560,9 @@ int main(int argc, char **argv) {
   printf("%d Devices ran a total of %lg Simulations\n", num_devices, number_of_sims);
   printf("Total Time(sec) = %.4f\n", diff*1e-9);
   printf("Throughput = %.2lf Billion Simulations / second\n", number_of_sims/diff);
+  // On the boards, the energy of the profiled black_scholes kernels rather than of the host window
+  double joules = use_cpu ? monitor_energy(start*1e-9, end*1e-9) : events_energy(e, num_devices);
+  print_energy(stdout, joules, diff*1e-9, number_of_sims, "simulation");
   cleanup();
   return 0;
 }
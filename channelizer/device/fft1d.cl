@@ -58,7 +58,8 @@ kernel void fft1d(uint count) {
     take_snapshot(0, 1);
     // Perform I/O transfers only when reading data in range
     if (i < count * (N / PPC)) {
-      float8 data_in = read_channel_altera(FFT_IN);
+      float8 data_in;
+      read_channel_counted(STAT_FFT_IN, FFT_IN, data_in);
       data.i0.x = data_in.s0;
       data.i0.y = 0;
       data.i1.x = data_in.s1;
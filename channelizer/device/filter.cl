@@ -89,7 +89,7 @@ void filter(uint count) {
     }
 
     // Send the samples off to the next stage in the pipeline
-    write_channel_altera(FILTER_OUT, output);
+    write_channel_counted(STAT_FILTER_OUT, FILTER_OUT, output);
   }
 }
 
@@ -47,7 +47,7 @@ kernel void reorder() {
   local float* buf = (local float*)buf8;
 
   // Read 8 points into the local buffer
-  buf8[lid] = read_channel_altera(REORDER_IN);
+  read_channel_counted(STAT_REORDER_IN, REORDER_IN, buf8[lid]);
   barrier(CLK_LOCAL_MEM_FENCE);
 
   // Stream fetched data over 8 channels to the FFT engine
@@ -59,5 +59,5 @@ kernel void reorder() {
   data.s5 = buf[5 * N/PPC + lid];
   data.s6 = buf[3 * N/PPC + lid];
   data.s7 = buf[7 * N/PPC + lid];
-  write_channel_altera(REORDER_OUT, data);
+  write_channel_counted(STAT_REORDER_OUT, REORDER_OUT, data);
 }
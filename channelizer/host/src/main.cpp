@@ -97,6 +97,7 @@ double2 *h_fft;
 cl_mem d_inData, d_outData;
 
 cl_event fevent;
+cl_event kevents[K_NUM_KERNELS];
 // Entry point.
 int main(int argc, char **argv) {
   Options options(argc, argv);
@@ -137,6 +138,7 @@ int main(int argc, char **argv) {
   }
   // init debug
   init_debug(context,program,device,&debug_kernel,&debug_queue);
+  start_monitor_sampler(MONITOR_SAMPLE_HZ, stdout);
   printf("Init complete!\n");
 
   // Allocate host memory
@@ -182,6 +184,7 @@ void test_channelizer(const int LOGN, const int P, const int PPC, const int ITER
 
   // Copy data from host to device
 //  printf("[%f] kaicheng: write buffer start\n", getCurrentTimestamp());
+  set_monitor_phase("write_buffer");
   status = clEnqueueWriteBuffer(queues[0], d_inData, CL_FALSE, 0, sizeof(float) * M, h_inData, 0, NULL, &fevent);
   checkError(status, "Failed to copy data to device");
   monitor_and_finish(queues[0], fevent, stdout);
@@ -203,26 +206,27 @@ void test_channelizer(const int LOGN, const int P, const int PPC, const int ITER
   checkError(status, "Failed to set kernel_wr arg 0");
 
   // Get the timestamp to evaluate performance
+  set_monitor_phase("channelizer");
   double time = getCurrentTimestamp();
   size_t window_size = N / PPC;
   size_t sample_size = window_size * ITERS;
   // READ
   status = clEnqueueNDRangeKernel(queues[K_READER], kernels[K_READER], 1, NULL, 
-    &sample_size, NULL, 0, NULL, NULL);
+    &sample_size, NULL, 0, NULL, &kevents[K_READER]);
   checkError(status, "Failed to launch kernel_read");
   // POLYPHASE
-  status = clEnqueueTask(queues[K_FILTER], kernels[K_FILTER], 0, NULL, NULL);
+  status = clEnqueueTask(queues[K_FILTER], kernels[K_FILTER], 0, NULL, &kevents[K_FILTER]);
   checkError(status, "Failed to launch kernel_read");
   // REORDER
   status = clEnqueueNDRangeKernel(queues[K_REORDER], kernels[K_REORDER], 1, NULL, 
-    &sample_size, &window_size, 0, NULL, NULL);
+    &sample_size, &window_size, 0, NULL, &kevents[K_REORDER]);
   checkError(status, "Failed to launch kernel_reorder");
   // FFT
-  status = clEnqueueTask(queues[K_FFT], kernels[K_FFT], 0, NULL, NULL);
+  status = clEnqueueTask(queues[K_FFT], kernels[K_FFT], 0, NULL, &kevents[K_FFT]);
   checkError(status, "Failed to launch kernel_fft");
   // Write
   status = clEnqueueNDRangeKernel(queues[K_WRITER], kernels[K_WRITER], 1, NULL, 
-    &sample_size, NULL, 0, NULL, NULL);
+    &sample_size, NULL, 0, NULL, &kevents[K_WRITER]);
   checkError(status, "Failed to launch kernel_write");
 
   // Wait for command queue to complete pending events
@@ -239,7 +243,13 @@ void test_channelizer(const int LOGN, const int P, const int PPC, const int ITER
   checkError(status, "Failed to copy data from device");
   monitor_and_finish(queues[K_WRITER], fevent, stdout);
 
+  // Energy over the profiled span of the pipeline kernels
+  clWaitForEvents(K_NUM_KERNELS, kevents);
+  const double energy = events_energy(kevents, K_NUM_KERNELS);
+  for(int i=0; i<K_NUM_KERNELS; ++i)
+    clReleaseEvent(kevents[i]);
   time = getCurrentTimestamp() - time;
+  set_monitor_phase(NULL);
 
 #if NUM_DEBUG_POINTS > 0
         //Read timer output from device
@@ -251,6 +261,16 @@ void test_channelizer(const int LOGN, const int P, const int PPC, const int ITER
         reset_debug_all_buffers(debug_kernel,debug_queue);
 #endif //NUM_DEBUG_POINTS
 
+#if NUM_CHANNEL_STATS >= 4
+        //Utilization of the pipeline stages, ids as in debug_defines.h
+        stamp_t*    channel_stats;
+        const char* channel_names[NUM_CHANNEL_STATS] = {"filter -> reorder","reorder <- filter",
+                                                        "reorder -> fft"   ,"fft <- reorder"};
+        read_channel_stats(&channel_stats);
+        print_channel_stats(channel_stats,channel_names);
+        reset_channel_stats();
+#endif //NUM_CHANNEL_STATS
+
 #if NUM_WATCH_POINTS > 0
         printf("Read The Watch\n");
         read_watch_all_buffers(context,debug_kernel,debug_queue,&watch_points);
@@ -260,6 +280,7 @@ void test_channelizer(const int LOGN, const int P, const int PPC, const int ITER
   printf("Total Time(sec) = %.4f\n", (float)(time));
   double gpoints_per_sec = ((double)(ITERS) * N / time) * 1E-9;
   printf("\tThroughput = %.4f Gpoints / sec\n", gpoints_per_sec);
+  print_energy(stdout, energy, time, (double)(ITERS) * N * 1E-9, "Gpoint");
 
   // Compare with golden
   filter_gold(h_inData, h_fft, N, P);
@@ -391,6 +412,7 @@ bool init() {
 
 // Free the resources allocated during initialization
 void cleanup() {
+  stop_monitor_sampler();
   for(int i=0; i<K_NUM_KERNELS; ++i) {
     if(kernels[i]) 
       clReleaseKernel(kernels[i]);  
@@ -0,0 +1,59 @@
+#ifndef ANALYSIS__H
+#define ANALYSIS__H
+
+#include <stdio.h>
+#include "AOCLUtils/debug.h"
+
+/* Analysis of the stamps of a trace point taken once per loop iteration. The interval between 
+ * two stamps is the cycles an iteration took, so the median interval is the typical initiation 
+ * interval and longer intervals are stalls. With sampling decimation the intervals are per 
+ * sampled iteration 
+ */
+
+/* Intervals above stall_factor times the median are stalls */
+#ifndef STALL_FACTOR
+#define STALL_FACTOR 4.0
+#endif
+
+/* Warm-up ends at the first run of this many intervals without a stall */
+#ifndef WARMUP_WINDOW
+#define WARMUP_WINDOW 16
+#endif
+
+typedef struct { 
+    cl_uint  point;
+    size_t   samples;
+    double   median_ii;          //Median interval in cycles
+    double   achieved_ii;        //Mean interval after warm-up in cycles
+    double   iterations_per_sec; //After warm-up, 0 without a clock
+    size_t   stalls;             //Runs of consecutive stalled intervals after warm-up
+    stamp_t  stall_cycles;       //Cycles of the stalled intervals above the median
+    stamp_t  longest_stall;      //Longest stalled interval in cycles
+    double   stalled_fraction;   //stall_cycles over the cycles after warm-up
+    size_t   warmup_samples;     //Samples before the steady state
+    stamp_t  warmup_cycles;      //Cycles before the steady state
+} trace_stats_s;
+
+
+/* Analyze count stamps of one trace point sorted in time. clock_mhz converts cycles to time, 0 
+ * uses the clock measured by init_debug. Returns 0, or -1 with fewer than two stamps */
+int analyze_trace_point(const stamp_t*  samples
+                       ,const size_t    count
+                       ,const double    clock_mhz
+                       ,const double    stall_factor
+                       ,trace_stats_s*  stats);
+
+
+/* Analyze every trace buffer of the array returned by read_debug_all_buffers into 
+ * stats[NUM_DEBUG_POINTS] */
+void analyze_trace(const stamp_t*  time_stamp
+                  ,const double    clock_mhz
+                  ,trace_stats_s*  stats);
+
+
+/* Print one line per trace point, e.g. "achieved II=1.03, 2.1% stalled cycles" */
+void print_trace_stats(const trace_stats_s* stats
+                      ,const int            num_points
+                      ,FILE*                out);
+
+#endif //ANALYSIS__H
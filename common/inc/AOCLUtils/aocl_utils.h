@@ -29,6 +29,8 @@
 #include "AOCLUtils/options.h"
 #include "AOCLUtils/monitor.h"
 #include "AOCLUtils/debug.h"
+#include "AOCLUtils/trace.h"
+#include "AOCLUtils/analysis.h"
 
 #endif
 
@@ -12,6 +12,22 @@
 
 
 
+/* Number and spacing of the read_time samples init_debug takes to calibrate the trace clock */
+#ifndef DEBUG_CALIBRATION_SAMPLES
+#define DEBUG_CALIBRATION_SAMPLES 8
+#endif
+#ifndef DEBUG_CALIBRATION_INTERVAL_MS
+#define DEBUG_CALIBRATION_INTERVAL_MS 10
+#endif
+
+/* Mapping of device time stamps to the host getCurrentTimestamp() clock */
+typedef struct { 
+    bool   valid;
+    double clock_mhz;          //Measured frequency of the time stamp counter
+    double host_at_cycle0;     //Host time in seconds of time stamp 0
+    double error_us;           //Uncertainty of the host alignment
+} debug_clock_s;
+
 /* Intiailize the timer infrastructure for debug and launch auto kernels if using emulator */
 void init_debug(const cl_context         context
                ,const cl_program         program
@@ -20,6 +36,14 @@ void init_debug(const cl_context         context
                ,      cl_command_queue** queue);
 
 
+/* Calibration of the trace clock measured by init_debug */
+const debug_clock_s* get_debug_clock();
+
+
+/* Host time in seconds, on the getCurrentTimestamp() axis, of a device time stamp */
+double debug_stamp_to_host(const stamp_t stamp);
+
+
 /* Read the sampled data into an array */
 void read_debug(const cl_context         context
                ,const cl_program         program
@@ -29,13 +53,31 @@ void read_debug(const cl_context         context
                ,stamp_t**                time_stamp);
 
 
-/* Read the sampled data from all trace buffers into an array */
+/* Read the sampled data from all trace buffers into an array with a single read_stamp launch. 
+ * The array is laid out as [buffer][DEBUG_TRACE_DEPTH+1] and is owned by the debug library,
+ * it is reused by the next read and must not be freed */
 void read_debug_all_buffers(const cl_context         context
                            ,const cl_program         program
                            ,const cl_kernel*         kernel
                            ,const cl_command_queue*  queue
                            ,stamp_t**                time_stamp); 
 
+/* Read the payloads of all trace buffers with a single read_stamp launch, see SNAPSHOT_PAYLOAD. 
+ * The array is laid out as [buffer][DEBUG_SAMPLE_DEPTH+1], the number of samples followed by 
+ * their payloads in the order read_debug_all_buffers returns the stamps. The array is owned by 
+ * the debug library and reused by the next read. Stop the buffers first so both reads agree. 
+ * Without payloads, SNAPSHOT_PAYLOAD 0 or DELTA_STAMPS, every buffer reads a 0 header */
+void read_payload_all_buffers(const cl_context         context
+                             ,const cl_kernel*         kernel
+                             ,const cl_command_queue*  queue
+                             ,cl_uint**                payload);
+
+/* Rebuild absolute time stamps from a DELTA_STAMPS trace buffer read from the device. raw holds 
+ * the number of 16-bit slots followed by DEBUG_SAMPLE_DEPTH packed words, time_stamp receives 
+ * the number of samples followed by up to DEBUG_TRACE_DEPTH stamps. Returns the number of samples */
+int decode_delta_stamps(const stamp_t* raw
+                       ,stamp_t*       time_stamp);
+
 /* Reset the sampler for next set of sample inputs */
 void reset_debug(const cl_kernel*          kernel
                 ,const cl_command_queue*   queue
@@ -47,6 +89,18 @@ void reset_debug_all_buffers(const cl_kernel*        kernel
                             ,const cl_command_queue* queue);
 
 
+/* Send cmd to every trace buffer set in buffer_mask with a single read_stamp launch once the 
+ * events in event_wait_list complete. Does not wait for the launch, the returned event must be 
+ * released by the caller (NULL on failure). D_RESET and the reads skip streaming buffers, NULL 
+ * when no buffer is left */
+cl_event control_buffers_async(const cl_kernel*        kernel
+                              ,const cl_command_queue* queue
+                              ,const cl_uint           buffer_mask
+                              ,const debug_command_e   cmd
+                              ,const cl_uint           num_events_in_wait_list
+                              ,const cl_event*         event_wait_list);
+
+
 
 
 /* Stop the trace buffer storing data*/
@@ -74,10 +128,178 @@ void start_cyclic_debug(const cl_kernel*          kernel
 
 
 
+/* Stop every trace buffer set in buffer_mask and arm its trigger. The buffer records cyclically 
+ * until the trigger fires and stops by itself pre+1+post samples later, see trigger_mode_e. 
+ * Read the window with read_debug, TRACE_TRIGGER of the header gives the trigger sample. Returns 
+ * NULL with DELTA_STAMPS or for a streaming buffer. The returned event must be released by the 
+ * caller */
+cl_event arm_trigger_async(const cl_kernel*        kernel
+                          ,const cl_command_queue* queue
+                          ,const cl_uint           buffer_mask
+                          ,const trigger_mode_e    mode
+                          ,const cl_uint           value
+                          ,const cl_uint           interval
+                          ,const cl_ushort         pre
+                          ,const cl_ushort         post);
+
+
+/* Arm the trigger of one trace buffer and wait until it is armed */
+void start_trigger_debug(const cl_kernel*          kernel
+                        ,const cl_command_queue*   queue
+                        ,const cl_int              buffer_id
+                        ,const trigger_mode_e      mode
+                        ,const cl_uint             value
+                        ,const cl_uint             interval
+                        ,const cl_ushort           pre
+                        ,const cl_ushort           post);
+
+
+
+
+/* Decimate the snapshots recorded by every trace buffer set in buffer_mask, see sampling_mode_e. 
+ * The setting holds until changed, S_EVERY with every 1 records every snapshot again. The 
+ * returned event must be released by the caller */
+cl_event set_sampling_async(const cl_kernel*        kernel
+                           ,const cl_command_queue* queue
+                           ,const cl_uint           buffer_mask
+                           ,const sampling_mode_e   mode
+                           ,const cl_ushort         every);
+
+
+/* Decimate the snapshots recorded by one trace buffer and wait until the setting is applied */
+void set_sampling_debug(const cl_kernel*          kernel
+                       ,const cl_command_queue*   queue
+                       ,const cl_int              buffer_id
+                       ,const sampling_mode_e     mode
+                       ,const cl_ushort           every);
+
+
+
+
+/* Start binning the intervals between stamps of the trace buffer into its histogram */
+void start_histogram_debug(const cl_kernel*          kernel
+                          ,const cl_command_queue*   queue
+                          ,const cl_int              buffer_id);
+
+
+/* Read the histograms of all trace buffers with a single read_stamp launch. Each histogram is 
+ * HISTOGRAM_BINS+2 words, the number of intervals, the bins and the longest interval. The array 
+ * is owned by the debug library and reused by the next read */
+void read_histogram_all_buffers(const cl_context         context
+                               ,const cl_kernel*         kernel
+                               ,const cl_command_queue*  queue
+                               ,stamp_t**                histogram);
+
+
+/* Interval in cycles below which percentile % of the intervals of one histogram fall, rounded up 
+ * to the bin boundary */
+stamp_t histogram_percentile(const stamp_t* histogram
+                            ,const double   percentile);
+
+
+/* Accumulate other into histogram, e.g. to combine runs */
+void merge_histogram(stamp_t*       histogram
+                    ,const stamp_t* other);
+
+
+/* Print p50, p99, max and the non-empty bins of all trace buffers */
+void print_histogram(const stamp_t* histogram);
+
+
+
+
+/* Number of stream blocks drained per stream_stamp launch */
+#ifndef STREAM_SLICE_BLOCKS
+#define STREAM_SLICE_BLOCKS 16
+#endif
+
+/* Stream the trace buffer into host memory while the kernels run. A consumer thread keeps 
+ * draining full halves of the trace buffer, so the trace is limited only by host memory */
+void start_stream_debug(const cl_context         context
+                       ,const cl_program         program
+                       ,const cl_device_id       device
+                       ,const cl_kernel*         kernel
+                       ,const cl_command_queue*  queue
+                       ,const cl_int             buffer_id);
+
+
+
+
+/* Stop streaming and wait for the last block. Returns the number of samples in time_stamp, 
+ * which must be freed by the caller, dropped is the number of stamps lost while the host 
+ * was behind. Until then the buffer ignores D_RESET and cannot be read */
+size_t stop_stream_debug(const cl_kernel*          kernel
+                        ,const cl_command_queue*   queue
+                        ,const cl_int              buffer_id
+                        ,stamp_t**                 time_stamp
+                        ,cl_ulong*                 dropped);
+
+
+
+
+/* Write the array returned by read_debug_all_buffers to a binary trace file, see trace.h. 
+ * payload is the array returned by read_payload_all_buffers for the same samples, or NULL. 
+ * clock_mhz is the kernel clock used to convert cycles to time, 0 uses the clock measured by 
+ * init_debug. Only the measured clock places the trace on the host clock. Without either clock 
+ * nothing is written. Returns 0 on success */
+int write_trace_file(const char*    file_name
+                    ,const stamp_t* time_stamp
+                    ,const cl_uint* payload
+                    ,const double   clock_mhz);
+
+
+
+
 /* Print the read timer values for all the channels */
 void print_debug(const stamp_t* time_stamp); 
 
 
+/* One sample of the time ordered merge of the trace buffers */
+typedef struct { 
+    stamp_t  stamp;
+    cl_uint  point;
+    cl_uint  payload;            //0 without payloads
+    size_t   index;              //Position of the sample in its trace buffer
+} trace_event_s;
+
+/* K-way merge of per point sample arrays, each sorted in time, into one time ordered stream. 
+ * The merge only keeps a cursor per point and a heap of the points by their next stamp, the 
+ * samples are read in place */
+typedef struct { 
+    const stamp_t* samples  [NUM_DEBUG_POINTS];
+    const cl_uint* payloads [NUM_DEBUG_POINTS];
+    size_t         count    [NUM_DEBUG_POINTS];
+    size_t         cursor   [NUM_DEBUG_POINTS];
+    cl_uint        heap     [NUM_DEBUG_POINTS];
+    int            heap_size;
+} trace_merge_s;
+
+/* Start a merge of NUM_DEBUG_POINTS arrays of count[i] stamps. payloads may be NULL, or hold 
+ * NULL for a point without payloads. Useful for the samples returned by stop_stream_debug */
+void trace_merge_init_points(trace_merge_s*  merge
+                            ,const stamp_t** samples
+                            ,const size_t*   count
+                            ,const cl_uint** payloads);
+
+
+/* Start a merge of the arrays returned by read_debug_all_buffers and read_payload_all_buffers, 
+ * payload may be NULL */
+void trace_merge_init(trace_merge_s*  merge
+                     ,const stamp_t*  time_stamp
+                     ,const cl_uint*  payload);
+
+
+/* Next event in time order, ties go to the lower point. Returns false once every point is done */
+bool trace_merge_next(trace_merge_s* merge
+                     ,trace_event_s* event);
+
+
+/* Print every sample of the trace buffers in time order with the cycles since the previous 
+ * event and since the previous event of the same point. payload may be NULL */
+void print_debug_merged(const stamp_t* time_stamp
+                       ,const cl_uint* payload);
+
+
 void read_watch(const cl_context         context
                ,const cl_kernel*         kernel
                ,const cl_command_queue*  queue
@@ -92,10 +314,23 @@ void read_watch_all_buffers(const cl_context         context
 
 void print_watch(const watch_s* watch_point);
 
+/* Print the heat map of range and mask watch points as rows of 8 region hit counters, each 
+ * starting at the region on the left, rows without hits are skipped */
+void print_watch_regions(const watch_s* watch_point);
+
 void reset_watch_all(const cl_kernel*        kernel
                     ,const cl_command_queue* queue); 
 
 
+/* Send cmd to every watch point set in watch_mask with a single read_watch launch, see 
+ * control_buffers_async */
+cl_event control_watches_async(const cl_kernel*        kernel
+                              ,const cl_command_queue* queue
+                              ,const cl_uint           watch_mask
+                              ,const debug_command_e   cmd
+                              ,const cl_uint           num_events_in_wait_list
+                              ,const cl_event*         event_wait_list);
+
 void control_watch(const cl_kernel*        kernel
                   ,const cl_command_queue* queue
                   ,const cl_int            watch_id
@@ -121,4 +356,57 @@ void start_cyclic_watch(const cl_kernel*          kernel
 
 
 
+/* Read the live counters of all trace buffers without stopping them, see LIVE_COUNTER_WORDS. 
+ * The array is laid out as [buffer][LIVE_COUNTER_WORDS], is owned by the debug library and 
+ * reused by the next read */
+void read_live_counters(const cl_context         context
+                       ,const cl_kernel*         kernel
+                       ,const cl_command_queue*  queue
+                       ,stamp_t**                counters);
+
+
+/* Clear the live counters of all trace buffers */
+void reset_live_counters(const cl_kernel*        kernel
+                        ,const cl_command_queue* queue);
+
+
+/* Print the live counters of every trace buffer, with the snapshot rate since previous taken 
+ * seconds earlier. previous may be NULL */
+void print_live_counters(const stamp_t* counters
+                        ,const stamp_t* previous
+                        ,const double   seconds
+                        ,FILE*          out);
+
+
+/* Print the live counters to out every period_ms from a background thread with its own queue 
+ * and read_stamp kernel, e.g. next to the print_monitor output of monitor_and_finish */
+void start_live_monitor(const cl_context         context
+                       ,const cl_program         program
+                       ,const cl_device_id       device
+                       ,const unsigned           period_ms
+                       ,FILE*                    out);
+
+
+/* Stop the live counter monitor and wait for its thread */
+void stop_live_monitor();
+
+
+
+/* Clear the counters of every channel stat, see write_channel_counted */
+void reset_channel_stats();
+
+
+/* Read the counters of every channel stat with a single read_channel_stats launch, the counters 
+ * keep running. The array is laid out as [stat][CHANNEL_STAT_WORDS], is owned by the debug 
+ * library and reused by the next read. NULL without NUM_CHANNEL_STATS */
+void read_channel_stats(stamp_t** stats);
+
+
+/* Print transfers, blocked cycles, longest block and the share of cycles spent transferring for 
+ * every channel stat. names holds NUM_CHANNEL_STATS labels or is NULL */
+void print_channel_stats(const stamp_t* stats
+                        ,const char**   names);
+
+
+
 #endif //DEBUG__H
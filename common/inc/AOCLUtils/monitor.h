@@ -4,8 +4,202 @@
 #include <stdio.h>
 #include <CL/opencl.h>
 
+/* Period of the temperature and power samples printed by monitor_and_finish */
+#ifndef MONITOR_PERIOD_MS
+#define MONITOR_PERIOD_MS 1000
+#endif
+
+/* Boards whose latest sample is kept by the sampler, also the most boards a model simulates */
+#ifndef MONITOR_MAX_BOARDS
+#define MONITOR_MAX_BOARDS 16
+#endif
+
+/* Default rate of the background sampler */
+#ifndef MONITOR_SAMPLE_HZ
+#define MONITOR_SAMPLE_HZ 10
+#endif
+
+/* Records kept by the background sampler before the writer drains them, a power of two. When the 
+ * ring is full new samples are dropped and counted */
+#ifndef MONITOR_RING_DEPTH
+#define MONITOR_RING_DEPTH 4096
+#endif
+
+/* Bytes the writer formats before a single write to the file */
+#ifndef MONITOR_WRITE_BUFFER
+#define MONITOR_WRITE_BUFFER 65536
+#endif
+
+/* Distinct phase names set_monitor_phase keeps */
+#ifndef MONITOR_MAX_PHASES
+#define MONITOR_MAX_PHASES 256
+#endif
+
+/* Period at which the writer drains the ring to the file */
+#ifndef MONITOR_DRAIN_MS
+#define MONITOR_DRAIN_MS 100
+#endif
+
+/* Samples kept for energy accounting, a power of two. At 10 Hz this covers about 27 minutes */
+#ifndef MONITOR_HISTORY_DEPTH
+#define MONITOR_HISTORY_DEPTH 16384
+#endif
+
+typedef struct {
+	double timestamp;
+	float  temperature;
+	float  power;
+	int    board;
+	int    phase;        //Phase set with set_monitor_phase when the sample was taken
+} monitor_sample_s;
+
+/* Board argument of print_monitor_board selecting every board */
+#define MONITOR_ALL_BOARDS -1
+
+/* Boards opened by the OpenCL runtime, as recorded by libhook, in open order */
+int monitor_num_boards();
+const char *monitor_board_name(int board);
+
+/* Read one board, read_monitor reads board 0. Returns < 0 for a closed or unknown board. While 
+ * the background sampler runs this is its last sample of the board */
+int read_monitor_board(int board, monitor_sample_s *sample);
+int read_monitor(monitor_sample_s *sample);
+
+/* Print one line per selected board, print_monitor prints every board */
+int print_monitor_board(FILE *f, int board);
 int print_monitor(FILE *f);
 cl_int monitor_and_finish(cl_command_queue queue, cl_event event, FILE *f);
+
+/* Source of the temperature and power samples. The live source queries the boards through the 
+ * MMD, the replay source plays back a recorded log and the model source simulates boards, so 
+ * the sampler, energy accounting and throttling run without an FPGA. Switch sources before 
+ * starting the background sampler 
+ */
+typedef struct {
+	const char *name;
+	int (*num_boards)(void *state);
+	const char *(*board_name)(void *state, int board);
+	int (*read)(void *state, int board, monitor_sample_s *sample);   //Fills temperature and power, < 0 if the board is closed
+	void *state;
+} monitor_source_s;
+
+/* A monitor log is the header, num_boards names and one record per sample read */
+#define MONITOR_LOG_MAGIC    "MONLOG\0\0"
+#define MONITOR_LOG_VERSION  1
+#define MONITOR_LOG_NAME_LEN 64
+
+typedef struct __attribute__((packed)) {
+	char     magic[8];
+	cl_uint  version;
+	cl_uint  num_boards;
+} monitor_log_header_s;
+
+typedef struct __attribute__((packed)) {
+	double   timestamp;
+	float    temperature;
+	float    power;
+	cl_int   board;
+} monitor_log_record_s;
+
+/* Synthetic boards drawing idle_w plus active_w for the duty fraction of every period_s */
+
+typedef struct {
+	int    boards;
+	double ambient_c;
+	double idle_w;
+	double active_w;
+	double period_s;
+	double duty;
+	double resistance_c_per_w;
+	double time_constant_s;
+} monitor_model_s;
+
+#define MONITOR_MODEL_DEFAULT {1, 30.0, 20.0, 25.0, 10.0, 0.5, 1.2, 30.0}
+
+/* Select the source, NULL or use_monitor_live for the boards. speed > 1 replays faster than 
+ * recorded. Without a call the MONITOR_REPLAY (a log or "model"), MONITOR_REPLAY_SPEED and 
+ * MONITOR_RECORD environment variables choose the source on the first read 
+ */
+void use_monitor_source(const monitor_source_s *source);
+int use_monitor_replay(const char *path, double speed);
+int use_monitor_model(const monitor_model_s *model, double speed);
+void use_monitor_live();
+
+/* Append every sample read from then on to a monitor log */
+int start_monitor_record(const char *path);
+void stop_monitor_record();
+
+/* Sample temperature and power of every board at rate_hz (1 to 1000) on a background thread. Samples are 
+ * written to f in batches in the print_monitor format by a second thread, while the sampler 
+ * runs print_monitor calls made through monitor_and_finish are skipped */
+int start_monitor_sampler(double rate_hz, FILE *f);
+
+/* Same, writing a CSV file with one row per sample : timestamp,board,temperature,power,phase. An 
+ * application calling start_monitor_sampler writes this file instead of its text when the 
+ * MONITOR_CSV environment variable names it */
+int start_monitor_csv(double rate_hz, const char *path);
+
+/* Tag the samples taken from now on with a kernel name or phase of the run, NULL for none */
+void set_monitor_phase(const char *name);
+void stop_monitor_sampler();
+bool monitor_sampler_running();
+unsigned long monitor_samples_dropped();
+
+/* Energy in joules all boards drew between two getCurrentTimestamp times, the trapezoidal integral 
+ * of the power samples of the background sampler. Power is held flat before the first and after 
+ * the last sample. Returns -1 when the sampler has no samples or t0 is older than the history */
+double monitor_energy(double t0, double t1);
+
+/* Same over the profiled execution of a command, from CL_PROFILING_COMMAND_START to _END. The 
+ * profiling times are moved to the host axis by the offset set_profiling_offset was given; 
+ * returns -1 without one */
+double profiled_energy(cl_ulong start_ns, cl_ulong end_ns);
+
+/* getCurrentTimestamp time at profiling time 0, measured by the clock calibration of init_debug */
+void set_profiling_offset(double host_at_profiling0);
+double event_energy(cl_event event);
+
+/* Same from the earliest start to the latest end of a set of commands, such as the kernels of a 
+ * pipeline or the same kernel on several boards. NULL events are skipped */
+double events_energy(const cl_event *events, int count);
+
+/* Temperature at which the board firmware clocks the FPGA down, and the band below it in which 
+ * work is shifted away from a board and its launches are paced */
+#ifndef THERMAL_LIMIT_C
+#define THERMAL_LIMIT_C 85.0
+#endif
+
+#ifndef THERMAL_GUARD_C
+#define THERMAL_GUARD_C 10.0
+#endif
+
+/* Longest pause before a launch on a board at the limit, and the smallest share of work a board 
+ * in the guard band keeps */
+#ifndef THERMAL_MAX_PACE_MS
+#define THERMAL_MAX_PACE_MS 200
+#endif
+
+#ifndef THERMAL_MIN_SHARE
+#define THERMAL_MIN_SHARE 0.1
+#endif
+
+/* Latest temperature of a board from the background sampler, NAN when the sampler does not run 
+ * or has no reading of the board. Device i of a context is taken to be board i, the boards are 
+ * opened in device order */
+float monitor_temperature(int board);
+
+/* Split total units of work across the first num_boards boards. Boards below the guard band or of 
+ * unknown temperature get equal shares, a board in the band a share shrinking linearly to 
+ * THERMAL_MIN_SHARE at the limit */
+void thermal_split(int num_boards, unsigned total, unsigned *share);
+
+/* Pause before a launch on a board in the guard band, from nothing at the bottom of the band to 
+ * THERMAL_MAX_PACE_MS at the limit, no pause for an unknown temperature. Returns the seconds paused */
+double thermal_pace(int board);
+
+/* Print the energy of a run and per unit of work next to a throughput line, e.g. 
+ * "Energy = 12.3 J, 4.1e-09 J / simulation, average 45.6 W" */
+void print_energy(FILE *f, double joules, double seconds, double work, const char *unit);
 cl_program getCPUKernel(cl_context context, const char *kernel_name, const cl_device_id *device_list);
 
 #endif
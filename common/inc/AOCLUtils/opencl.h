@@ -77,6 +77,15 @@ cl_program createProgramFromBinary(cl_context context, const char *binary_file_n
 // Return value must be freed with delete[].
 unsigned char *loadBinaryFile(const char *file_name, size_t *size);
 
+// Map binary file read-only.
+// The mapping is cached for the life of the process and reused while the file's path,
+// size and modification time are unchanged, so a context recreated from the same AOCX
+// does not read it again. Return value must not be freed, see releaseBinaryCache.
+const unsigned char *mapBinaryFile(const char *file_name, size_t *size);
+
+// Unmap every cached binary.
+void releaseBinaryCache();
+
 // Checks if a file exists.
 bool fileExists(const char *file_name);
 
@@ -0,0 +1,49 @@
+#ifndef TRACE__H
+#define TRACE__H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Binary trace file written by write_trace_file. The file is a trace_file_header_s followed by 
+ * num_points blocks, each a trace_point_header_s followed by count 64-bit time stamps in cycles 
+ * and, with TRACE_POINT_PAYLOAD, count 32-bit snapshot payloads. 
+ * The format does not depend on debug_defines.h so the converters can be built stand alone 
+ */
+#define TRACE_FILE_MAGIC   "AOCLTRC"
+#define TRACE_FILE_VERSION 3
+
+/* Trace point flags */
+#define TRACE_POINT_FULL    0x1   //Trace buffer filled up, later stamps were dropped or overwritten
+#define TRACE_POINT_PAYLOAD 0x2   //Stamps are followed by their payloads
+
+typedef struct { 
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_points;
+    double   clock_mhz;          //Kernel clock, converts cycles to microseconds
+    double   wall_anchor;        //Wall clock time in seconds when the trace was written
+    double   host_anchor;        //getCurrentTimestamp() at the same moment
+    double   host_at_cycle0;     //getCurrentTimestamp() domain time of cycle 0, 0 if not calibrated
+    uint64_t overflow_mask;      //Bit i set when trace point i has TRACE_POINT_FULL
+} trace_file_header_s;
+
+typedef struct { 
+    uint32_t point;
+    uint32_t flags;
+    uint64_t count;
+} trace_point_header_s;
+
+
+/* Read and check the file header, returns 0 on success */
+int read_trace_header(FILE* fp, trace_file_header_s* header);
+
+
+/* Convert a binary trace file to Chrome trace event JSON in a single pass. Every stamp becomes a 
+ * complete event lasting until the next stamp of the same point, one timeline row per point, 
+ * with its payload as the value argument. 
+ * Calibrated traces are placed on the getCurrentTimestamp() axis used by the host logs. 
+ * Returns the number of events written or -1 on error, also for a trace without a kernel clock */
+long trace_to_chrome_json(const char* trace_file_name
+                         ,const char* json_file_name);
+
+#endif //TRACE__H
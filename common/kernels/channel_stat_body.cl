@@ -0,0 +1,45 @@
+    stamp_t         transfers    = 0;
+    stamp_t         blocked      = 0;
+    stamp_t         longest      = 0;
+    bool            reading      = false;
+    int             read_count   = 0;
+    #pragma acc kernels loop independent
+    for(ulong infinite_counter = 0; infinite_counter < ULONG_MAX ; infinite_counter++) { 
+    uint            event;
+    bool            event_valid;
+    debug_command_e cmd;
+    bool            cmd_valid;
+        event = read_channel_nb_altera(stat_event_c[stat_id], &event_valid);
+        cmd   = read_channel_nb_altera(stat_cmd_c[stat_id],   &cmd_valid);
+
+        if(cmd_valid) { 
+            if(cmd == D_RESET) { 
+                transfers  = 0;
+                blocked    = 0;
+                longest    = 0;
+            }
+            else if(cmd == D_READ) { 
+                reading    = true;
+                read_count = 0;
+            }
+        }
+
+        //Each event is one transfer and the cycles it waited on the channel
+        if(event_valid & !(cmd_valid & (cmd == D_RESET))) { 
+            transfers++;
+            blocked += event;
+            longest  = event > longest ? event : longest;
+        }
+
+        //Counters keep running while they are read out
+        if(reading) { 
+        stamp_t stat_out;
+            stat_out = read_count == 0 ? transfers : 
+                       read_count == 1 ? blocked   : longest;
+            if(write_channel_nb_altera(stat_out_c[stat_id], stat_out)) { 
+                read_count++;
+                reading = read_count < CHANNEL_STAT_WORDS;
+            }
+            mem_fence(CLK_CHANNEL_MEM_FENCE);
+        }
+    }
@@ -3,10 +3,34 @@
 
 #include "timer.h"
 
+#ifdef EMULATOR
+/* The emulator has no autorun kernels, every trace buffer and watch point is its own kernel. 
+ * DEBUG_EMULATOR_KERNELS emits the ten kernels <kind>_<block>0 to <kind>_<block>9 for ids 
+ * base to base+9, kernels past num return at once and are never launched by the host */
+#define DEBUG_EMULATOR_KERNEL(kind, name, id, num) \
+    void kernel kind##_##name() { if((id) < (num)) kind##_emulate(id); }
+
+#define DEBUG_EMULATOR_KERNELS(kind, block, base, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##0, base + 0, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##1, base + 1, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##2, base + 2, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##3, base + 3, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##4, base + 4, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##5, base + 5, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##6, base + 6, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##7, base + 7, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##8, base + 8, num) \
+    DEBUG_EMULATOR_KERNEL(kind, block##9, base + 9, num) 
+#endif //EMULATOR
+
 #if NUM_DEBUG_POINTS > 0 
-channel short            time_in_c    [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel uint             time_in_c    [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 channel debug_command_e  command_c    [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 channel stamp_t          read_stamp_c [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel stamp_t          stream_stamp_c [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel trigger_cfg_s    trigger_cfg_c  [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel sampling_cfg_s   sampling_cfg_c [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel stamp_t          live_stamp_c   [NUM_DEBUG_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 #endif //NUM_DEBUG_POINTS 0
 
 #if NUM_WATCH_POINTS > 0
@@ -14,8 +38,15 @@ channel int              addr_in_c   [NUM_WATCH_POINTS] __attribute__((depth(DEB
 channel watch_s          watch_in_c  [NUM_WATCH_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 channel watch_s          watch_out_c [NUM_WATCH_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 channel debug_command_e  watch_cmd_c [NUM_WATCH_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel watch_cfg_s      watch_cfg_c [NUM_WATCH_POINTS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
 #endif //NUM_WATCH_POINTS > 0
 
+#if NUM_CHANNEL_STATS > 0
+channel uint             stat_event_c [NUM_CHANNEL_STATS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel debug_command_e  stat_cmd_c   [NUM_CHANNEL_STATS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+channel stamp_t          stat_out_c   [NUM_CHANNEL_STATS] __attribute__((depth(DEBUG_CHANNEL_DEPTH)));
+#endif //NUM_CHANNEL_STATS > 0
+
 
 void add_watch(uint id, size_t address) { 
 #if NUM_WATCH_POINTS > 0
@@ -24,6 +55,62 @@ void add_watch(uint id, size_t address) {
 #endif 
 }
 
+void add_watch_range(uint id, size_t base, size_t size, uchar region_shift) { 
+#if NUM_WATCH_POINTS > 0
+    watch_cfg_s cfg;
+    cfg.base         = (uint) base;
+    cfg.limit        = (uint) (base + size);
+    cfg.mode         = W_RANGE;
+    cfg.region_shift = region_shift;
+    if(id < NUM_WATCH_POINTS) 
+        (void) write_channel_nb_altera(watch_cfg_c[id],cfg);
+#endif 
+}
+
+void add_watch_mask(uint id, size_t base, size_t mask, uchar region_shift) { 
+#if NUM_WATCH_POINTS > 0
+    watch_cfg_s cfg;
+    cfg.base         = (uint) base;
+    cfg.limit        = (uint) mask;
+    cfg.mode         = W_MASK;
+    cfg.region_shift = region_shift;
+    if(id < NUM_WATCH_POINTS) 
+        (void) write_channel_nb_altera(watch_cfg_c[id],cfg);
+#endif 
+}
+
+void channel_transfer(uint id, uint blocked_cycles) { 
+#if NUM_CHANNEL_STATS > 0
+    if(id < NUM_CHANNEL_STATS) 
+        (void) write_channel_nb_altera(stat_event_c[id], blocked_cycles);
+#endif 
+}
+
+/* Blocking channel read and write that count the transfer and the cycles it was blocked in 
+ * channel stat id. Without NUM_CHANNEL_STATS they are the plain blocking calls */
+#if NUM_CHANNEL_STATS > 0
+#define write_channel_counted(id, ch, value) do { \
+        uint stat_blocked_ = 0; \
+        while(!write_channel_nb_altera(ch, value)) \
+            stat_blocked_++; \
+        channel_transfer(id, stat_blocked_); \
+    } while(0)
+
+#define read_channel_counted(id, ch, dest) do { \
+        uint stat_blocked_ = 0; \
+        bool stat_valid_; \
+        dest = read_channel_nb_altera(ch, &stat_valid_); \
+        while(!stat_valid_) { \
+            stat_blocked_++; \
+            dest = read_channel_nb_altera(ch, &stat_valid_); \
+        } \
+        channel_transfer(id, stat_blocked_); \
+    } while(0)
+#else 
+#define write_channel_counted(id, ch, value) write_channel_altera(ch, value)
+#define read_channel_counted(id, ch, dest)   dest = read_channel_altera(ch)
+#endif //NUM_CHANNEL_STATS > 0
+
 void monitor_address(uint id, size_t addr, ushort tag) { 
 #if NUM_WATCH_POINTS > 0
     watch_s in;
@@ -41,7 +128,16 @@ void monitor_address(uint id, size_t addr, ushort tag) {
 void take_snapshot(uint id, stamp_t in) { 
 #if NUM_DEBUG_POINTS > 0
     if(id < NUM_DEBUG_POINTS) {
-        (void) write_channel_nb_altera(time_in_c[id],(short) in);
+        (void) write_channel_nb_altera(time_in_c[id],(uint) (ushort) in);
+        mem_fence(CLK_CHANNEL_MEM_FENCE);
+    }
+#endif 
+}
+
+void take_snapshot_value(uint id, uint value) { 
+#if NUM_DEBUG_POINTS > 0
+    if(id < NUM_DEBUG_POINTS) {
+        (void) write_channel_nb_altera(time_in_c[id],value);
         mem_fence(CLK_CHANNEL_MEM_FENCE);
     }
 #endif 
@@ -55,42 +151,21 @@ void sample_stamp_emulate(uchar buffer_id) {
     #include "sample_stamp_body.cl"
 }
 
-#if NUM_DEBUG_POINTS > 0 
-    void kernel sample_stamp_0() { sample_stamp_emulate(0); }
-#endif  //0
-#if NUM_DEBUG_POINTS > 1 
-    void kernel sample_stamp_1() { sample_stamp_emulate(1); }
-#endif  //1
-#if NUM_DEBUG_POINTS > 2 
-    void kernel sample_stamp_2() { sample_stamp_emulate(2); }
-#endif  //2
-#if NUM_DEBUG_POINTS > 3 
-    void kernel sample_stamp_3() { sample_stamp_emulate(3); }
-#endif  //3
-#if NUM_DEBUG_POINTS > 4 
-    void kernel sample_stamp_4() { sample_stamp_emulate(4); }
-#endif  //4
-#if NUM_DEBUG_POINTS > 5 
-    void kernel sample_stamp_5() { sample_stamp_emulate(5); }
-#endif  //5
-#if NUM_DEBUG_POINTS > 6 
-    void kernel sample_stamp_6() { sample_stamp_emulate(6); }
-#endif  //6
-#if NUM_DEBUG_POINTS > 7 
-    void kernel sample_stamp_7() { sample_stamp_emulate(7); }
-#endif  //7
-#if NUM_DEBUG_POINTS > 8 
-    void kernel sample_stamp_8() { sample_stamp_emulate(8); }
-#endif  //8
-#if NUM_DEBUG_POINTS > 9 
-    void kernel sample_stamp_9() { sample_stamp_emulate(9); }
-#endif  //9
-#if NUM_DEBUG_POINTS > 10 
-    void kernel sample_stamp_10() { sample_stamp_emulate(10); }
-#endif  //10
-#if NUM_DEBUG_POINTS > 11 
-    #pragma error "Maximum 11 channels are supported for emulator" 
-#endif //11
+/* sample_stamp_0 to sample_stamp_<NUM_DEBUG_POINTS-1> as named by init_debug, trace buffers 
+ * are addressed with 32-bit masks */
+#if NUM_DEBUG_POINTS > 32
+    #error "At most 32 trace buffers are supported, buffer masks are 32-bit"
+#endif
+    DEBUG_EMULATOR_KERNELS(sample_stamp, , 0, NUM_DEBUG_POINTS)
+#if NUM_DEBUG_POINTS > 10
+    DEBUG_EMULATOR_KERNELS(sample_stamp, 1, 10, NUM_DEBUG_POINTS)
+#endif
+#if NUM_DEBUG_POINTS > 20
+    DEBUG_EMULATOR_KERNELS(sample_stamp, 2, 20, NUM_DEBUG_POINTS)
+#endif
+#if NUM_DEBUG_POINTS > 30
+    DEBUG_EMULATOR_KERNELS(sample_stamp, 3, 30, NUM_DEBUG_POINTS)
+#endif
 
 #else 
 
@@ -106,38 +181,150 @@ void sample_stamp() {
 
 #endif //EMULATOR
 
+/* cmd is sent to trace_buffer_id, to every buffer with ALL_DEBUG_POINTS, and to every buffer 
+ * set in buffer_mask. The read commands drain trace_buffer_id or all buffers into output */
 __attribute__((max_global_work_dim(0)))
 __kernel
 void read_stamp( debug_command_e  cmd,
                 __global stamp_t* restrict output,
-                uint trace_buffer_id) {
+                uint trace_buffer_id,
+                uint buffer_mask) {
 
-    uint id = trace_buffer_id;
+    uint id  = trace_buffer_id;
+    bool all = (id == ALL_DEBUG_POINTS);
 
     //printf("enter read stamp \n");     
     #pragma unroll
     for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
         //printf("before write\n");     
-        if(i == id) 
+        if(all | (i == id) | ((buffer_mask >> i) & 1)) 
              write_channel_altera(command_c[i], (debug_command_e) cmd);
         //printf("after write \n");     
     }
 
-    if(cmd == D_READ) { 
+    if(cmd == D_READ_COUNTERS) { 
+    /* Live counters are drained into output laid out as [buffer][LIVE_COUNTER_WORDS] */
+    uint buffer     = all ? 0 : id;
+    uint last       = all ? NUM_DEBUG_POINTS - 1 : id;
+    int  offset     = 0;
+        for(; buffer <= last; buffer++) { 
+            for(int word = 0; word < LIVE_COUNTER_WORDS; word++) { 
+            stamp_t out;
+                #pragma unroll
+                for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
+                    if(i == buffer) 
+                        out = read_channel_altera(live_stamp_c[i]);
+                }
+                output[offset] = out; 
+                offset++;
+            }
+        }
+    }
+
+    if((cmd == D_READ) | (cmd == D_READ_PAYLOAD) | (cmd == D_READ_HISTOGRAM)) { 
     //printf("enter if D_READ\n");     
-    //buffer_s out;
-    stamp_t out;
-        for(int read_count = 0; read_count <= DEBUG_SAMPLE_DEPTH; read_count++) { 
+    /* With ALL_DEBUG_POINTS the buffers are drained back to back into output laid out 
+     * as [buffer][DEBUG_SAMPLE_DEPTH+1], or [buffer][HISTOGRAM_BINS+2] for a histogram, 
+     * otherwise only trace buffer id is drained */
+    uint buffer     = all ? 0 : id;
+    uint last       = all ? NUM_DEBUG_POINTS - 1 : id;
+    int  last_word  = cmd == D_READ_HISTOGRAM ? HISTOGRAM_BINS + 1 : DEBUG_SAMPLE_DEPTH;
+    int  read_count = 0;
+    int  offset     = 0;
+        while(buffer <= last) { 
+        //buffer_s out;
+        stamp_t out;
             //printf("read count: %d\n", read_count);     
             #pragma unroll
             for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
-                if(i == id) 
+                if(i == buffer) 
                     out = read_channel_altera(read_stamp_c[i]);
             }
             //output[read_count] = (stamp_t) ((((ulong) out.hi) << 32) | out.lo);
-            output[read_count] = out; 
+            output[offset] = out; 
             mem_fence(CLK_CHANNEL_MEM_FENCE);
-            //printf("Read Out = %0lu \n", output[read_count]);     
+            //printf("Read Out = %0lu \n", output[offset]);     
+            offset++;
+            if(read_count == last_word) { 
+                read_count = 0;
+                buffer++;
+            }
+            else 
+                read_count++;
+        }
+    }
+}
+
+/* Arm the trigger of every stopped trace buffer set in buffer_mask. pre is clipped to 
+ * DEBUG_SAMPLE_DEPTH-1 and post to the space left after pre and the trigger sample */
+__attribute__((max_global_work_dim(0)))
+__kernel
+void set_trigger(uint   buffer_mask,
+                 uchar  mode,
+                 uint   value,
+                 uint   interval,
+                 ushort pre,
+                 ushort post) { 
+    trigger_cfg_s cfg;
+    cfg.value    = value;
+    cfg.interval = interval;
+    cfg.pre      = pre;
+    cfg.post     = post;
+    cfg.mode     = mode;
+    #pragma unroll
+    for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
+        if((buffer_mask >> i) & 1) 
+             write_channel_altera(trigger_cfg_c[i], cfg);
+    }
+}
+
+/* Set the decimation of every trace buffer set in buffer_mask, it applies from the next snapshot 
+ * and is kept across D_RESET */
+__attribute__((max_global_work_dim(0)))
+__kernel
+void set_sampling(uint   buffer_mask,
+                  uchar  mode,
+                  ushort every) { 
+    sampling_cfg_s cfg;
+    cfg.every = every;
+    cfg.mode  = mode;
+    #pragma unroll
+    for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
+        if((buffer_mask >> i) & 1) 
+             write_channel_altera(sampling_cfg_c[i], cfg);
+    }
+}
+
+/* Sample the free running counter, used by the host to correlate device and host clocks */
+__attribute__((max_global_work_dim(0)))
+__kernel
+void read_time(__global stamp_t* restrict output) { 
+    output[0] = get_time(0);
+}
+
+/* Drain up to num_blocks streamed blocks of trace_buffer_id into ring, each block is 
+ * STREAM_BLOCK_DEPTH+1 words written back to back. Returns after the last block of a 
+ * stopped stream */
+__attribute__((max_global_work_dim(0)))
+__kernel
+void stream_stamp(__global stamp_t* restrict ring,
+                  uint num_blocks,
+                  uint trace_buffer_id) { 
+
+    uint id   = trace_buffer_id;
+    bool last = false;
+
+    for(uint block = 0; (block < num_blocks) & !last; block++) { 
+        for(int word = 0; word <= STREAM_BLOCK_DEPTH; word++) { 
+        stamp_t out;
+            #pragma unroll
+            for(int i = 0; i < NUM_DEBUG_POINTS; i++) {
+                if(i == id) 
+                    out = read_channel_altera(stream_stamp_c[i]);
+            }
+            if(word == 0) 
+                last = (out >> 63) & 1;
+            ring[block*(STREAM_BLOCK_DEPTH+1) + word] = out;
         }
     }
 }
@@ -150,42 +337,20 @@ void watch_addr_emulate(uchar watch_id) {
     #include "watch_addr_body.cl"
 }
 
-#if NUM_WATCH_POINTS > 0 
-    void kernel watch_addr_0() { watch_addr_emulate(0); }
-#endif  //0
-#if NUM_WATCH_POINTS > 1 
-    void kernel watch_addr_1() { watch_addr_emulate(1); }
-#endif  //1
-#if NUM_WATCH_POINTS > 2 
-    void kernel watch_addr_2() { watch_addr_emulate(2); }
-#endif  //2
-#if NUM_WATCH_POINTS > 3 
-    void kernel watch_addr_3() { watch_addr_emulate(3); }
-#endif  //3
-#if NUM_WATCH_POINTS > 4 
-    void kernel watch_addr_4() { watch_addr_emulate(4); }
-#endif  //4
-#if NUM_WATCH_POINTS > 5 
-    void kernel watch_addr_5() { watch_addr_emulate(5); }
-#endif  //5
-#if NUM_WATCH_POINTS > 6 
-    void kernel watch_addr_6() { watch_addr_emulate(6); }
-#endif  //6
-#if NUM_WATCH_POINTS > 7 
-    void kernel watch_addr_7() { watch_addr_emulate(7); }
-#endif  //7
-#if NUM_WATCH_POINTS > 8 
-    void kernel watch_addr_8() { watch_addr_emulate(8); }
-#endif  //8
-#if NUM_WATCH_POINTS > 9 
-    void kernel watch_addr_9() { watch_addr_emulate(9); }
-#endif  //9
-#if NUM_WATCH_POINTS > 10 
-    void kernel watch_addr_10() { watch_addr_emulate(10); }
-#endif  //10
-#if NUM_WATCH_POINTS > 11 
-    #pragma error "Maximum 11 channels are supported for emulator" 
-#endif //11
+/* watch_addr_0 to watch_addr_<NUM_WATCH_POINTS-1> */
+#if NUM_WATCH_POINTS > 32
+    #error "At most 32 watch points are supported, watch masks are 32-bit"
+#endif
+    DEBUG_EMULATOR_KERNELS(watch_addr, , 0, NUM_WATCH_POINTS)
+#if NUM_WATCH_POINTS > 10
+    DEBUG_EMULATOR_KERNELS(watch_addr, 1, 10, NUM_WATCH_POINTS)
+#endif
+#if NUM_WATCH_POINTS > 20
+    DEBUG_EMULATOR_KERNELS(watch_addr, 2, 20, NUM_WATCH_POINTS)
+#endif
+#if NUM_WATCH_POINTS > 30
+    DEBUG_EMULATOR_KERNELS(watch_addr, 3, 30, NUM_WATCH_POINTS)
+#endif
 
 #else 
 
@@ -201,20 +366,22 @@ void watch_addr() {
 
 #endif //EMULATOR
 
+/* cmd is sent to watch_id and to every watch point set in watch_mask */
 __attribute__((max_global_work_dim(0))) 
 __kernel 
 void read_watch(debug_command_e cmd,
                 __global watch_s* restrict output,
-                uint watch_id) { 
+                uint watch_id,
+                uint watch_mask) { 
     uint id = watch_id;
     #pragma unroll
     for(int i = 0; i < NUM_WATCH_POINTS; i++) {
-        if(i == id) 
+        if((i == id) | ((watch_mask >> i) & 1)) 
              write_channel_altera(watch_cmd_c[i], (debug_command_e) cmd);
     }
 
     if(cmd == D_READ) { 
-        for(int read_count = 0; read_count < WATCH_SAMPLE_DEPTH+2; read_count++) { 
+        for(int read_count = 0; read_count < WATCH_READ_DEPTH; read_count++) { 
             #pragma unroll
             for(int i = 0; i < NUM_WATCH_POINTS; i++) {
                 if(i == id) {
@@ -228,4 +395,66 @@ void read_watch(debug_command_e cmd,
 }
 #endif //NUM_WATCH_POINTS
 
+#if NUM_CHANNEL_STATS > 0
+
+#ifdef EMULATOR
+void channel_stat_emulate(uchar stat_id) {
+    #include "channel_stat_body.cl"
+}
+
+/* channel_stat_0 to channel_stat_<NUM_CHANNEL_STATS-1> */
+#if NUM_CHANNEL_STATS > 32
+    #error "At most 32 channel stats are supported"
+#endif
+    DEBUG_EMULATOR_KERNELS(channel_stat, , 0, NUM_CHANNEL_STATS)
+#if NUM_CHANNEL_STATS > 10
+    DEBUG_EMULATOR_KERNELS(channel_stat, 1, 10, NUM_CHANNEL_STATS)
+#endif
+#if NUM_CHANNEL_STATS > 20
+    DEBUG_EMULATOR_KERNELS(channel_stat, 2, 20, NUM_CHANNEL_STATS)
+#endif
+#if NUM_CHANNEL_STATS > 30
+    DEBUG_EMULATOR_KERNELS(channel_stat, 3, 30, NUM_CHANNEL_STATS)
+#endif
+
+#else 
+
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+__attribute__((num_compute_units(NUM_CHANNEL_STATS,1)))
+kernel
+void channel_stat() { 
+    uint stat_id; 
+    stat_id = get_compute_id(0);
+    #include "channel_stat_body.cl"
+}
+
+#endif //EMULATOR
+
+/* cmd is sent to every channel stat, D_READ drains them into output laid out as 
+ * [stat][CHANNEL_STAT_WORDS] */
+__attribute__((max_global_work_dim(0))) 
+__kernel 
+void read_channel_stats(debug_command_e cmd,
+                        __global stamp_t* restrict output) { 
+    #pragma unroll
+    for(int i = 0; i < NUM_CHANNEL_STATS; i++) 
+        write_channel_altera(stat_cmd_c[i], (debug_command_e) cmd);
+
+    if(cmd == D_READ) { 
+        for(int stat = 0; stat < NUM_CHANNEL_STATS; stat++) { 
+            for(int word = 0; word < CHANNEL_STAT_WORDS; word++) { 
+            stamp_t out;
+                #pragma unroll
+                for(int i = 0; i < NUM_CHANNEL_STATS; i++) {
+                    if(i == stat) 
+                        out = read_channel_altera(stat_out_c[i]);
+                }
+                output[stat*CHANNEL_STAT_WORDS + word] = out;
+            }
+        }
+    }
+}
+#endif //NUM_CHANNEL_STATS
+
 #endif //DEBUG__CL
@@ -1,46 +1,253 @@
     //buffer_s        debug_memory[DEBUG_SAMPLE_DEPTH];
     stamp_t         debug_memory[DEBUG_SAMPLE_DEPTH];
+#if SNAPSHOT_PAYLOAD
+    uint            payload_memory[DEBUG_SAMPLE_DEPTH];
+#endif
     int             sampled_point;
     debug_command_e state        = D_RESET;
     int             read_count;
+    uchar           stream_half;
+    bool            stream_stop;
+    uint            stream_dropped;
+    bool            flush_pending;
+    uchar           flush_half;
+    int             flush_index;
+    uchar           flush_tail;
+    stamp_t         flush_header;
+    stamp_t         histogram[HISTOGRAM_BINS];
+    int             hist_cleared;
+    stamp_t         hist_count;
+    stamp_t         hist_max;
+    stamp_t         hist_last;
+    bool            hist_valid;
+    bool            trig_window;
+    bool            trig_fired;
+    uchar           trig_mode;
+    uint            trig_value;
+    uint            trig_interval;
+    int             trig_pre;
+    int             trig_post;
+    int             trig_before;
+    int             trig_after;
+    stamp_t         trig_last;
+    bool            trig_last_valid;
+    trigger_cfg_s   trig_held;
+    bool            trig_held_valid = false;
+    uchar           decimate_mode  = S_EVERY;
+    ushort          decimate_every = 1;
+    ushort          decimate_mask  = 0;
+    ushort          decimate_count = 0;
+    ushort          decimate_lfsr  = 0xACE1;
+    bool            overflow;    
+    stamp_t         live_count     = 0;
+    stamp_t         live_min       = ULONG_MAX;
+    stamp_t         live_max       = 0;
+    stamp_t         live_sum       = 0;
+    stamp_t         live_lost      = 0;
+    stamp_t         live_last;
+    stamp_t         live_latch[LIVE_COUNTER_WORDS];
+    bool            live_reading   = false;
+    int             live_word;
+#if DELTA_STAMPS
+    stamp_t         pack_lo;
+    stamp_t         pack_hi;
+    uchar           pack_fill;
+    stamp_t         last_stamp;
+    bool            stamp_valid;
+#endif
     #pragma acc kernels loop independent
     for(ulong infinite_counter = 0; infinite_counter < ULONG_MAX ; infinite_counter++) { 
     debug_command_e next_state;
     bool            rvalid;
     bool            read_valid;
-    short           take_stamp;
-    bool            overflow;    
+    uint            take_stamp;
     stamp_t         time_stamp;
+    trigger_cfg_s   trig_cfg;
+    bool            cfg_valid;
+    sampling_cfg_s  samp_cfg;
+    bool            samp_valid;
         take_stamp = read_channel_nb_altera(time_in_c[buffer_id], &read_valid);
         next_state = read_channel_nb_altera(command_c[buffer_id], &rvalid);
+        trig_cfg   = read_channel_nb_altera(trigger_cfg_c[buffer_id], &cfg_valid);
+        samp_cfg   = read_channel_nb_altera(sampling_cfg_c[buffer_id], &samp_valid);
         time_stamp = get_time((stamp_t)take_stamp);  
         if(rvalid) {
             switch(next_state) {
                 case D_RESET: 
                 case D_STOP : 
                 case D_READ : 
-                    state = next_state;
+                case D_READ_PAYLOAD : 
+                case D_READ_HISTOGRAM : 
+                    //A streaming buffer stops only after its last block is flushed, any command 
+                    //leaving the stream waits for that, the drains in flight need their blocks
+                    if(state == D_RECORD_STREAM)
+                        stream_stop = true;
+                    else
+                        state = next_state;
                     break;
                 case D_RECORD_CYCLIC: 
                 case D_RECORD: 
-                    state = state == D_STOP ? next_state : state; 
+                case D_HISTOGRAM: 
+                    if(state == D_STOP) { 
+                        state       = next_state; 
+                        trig_window = false;
+                    }
+                    break;
+                case D_RECORD_STREAM: 
+                    if(state == D_STOP) { 
+                        state          = next_state;
+                        sampled_point  = 0;
+                        stream_half    = 0;
+                        stream_stop    = false;
+                        stream_dropped = 0;
+                        flush_pending  = false;
+                        flush_index    = 0;
+                        flush_tail     = 0;
+                        trig_window    = false;
+                    }
+                    break;
+                //Live counters are latched and read or cleared without leaving the state
+                case D_READ_COUNTERS: 
+                    live_latch[0] = live_count;
+                    live_latch[1] = live_min;
+                    live_latch[2] = live_max;
+                    live_latch[3] = live_sum;
+                    live_latch[4] = live_lost;
+                    live_reading  = true;
+                    live_word     = 0;
+                    break;
+                case D_RESET_COUNTERS: 
+                    live_count    = 0;
+                    live_min      = ULONG_MAX;
+                    live_max      = 0;
+                    live_sum      = 0;
+                    live_lost     = 0;
                     break;
                 default : 
                     break;
             } 
             //printf("Read Command %0d\n", next_state);
         }
+
+        //Live counters see every snapshot, before decimation and in every state
+        if(read_valid) { 
+        stamp_t interval = time_stamp - live_last;
+            if(live_count > 0) { 
+                live_min  = interval < live_min ? interval : live_min;
+                live_max  = interval > live_max ? interval : live_max;
+                live_sum += interval;
+            }
+            live_count++;
+            live_last = time_stamp;
+        }
+        if(live_reading) { 
+            if(write_channel_nb_altera(live_stamp_c[buffer_id], live_latch[live_word])) { 
+                live_word++;
+                live_reading = live_word < LIVE_COUNTER_WORDS;
+            }
+            mem_fence(CLK_CHANNEL_MEM_FENCE);
+        }
+
+        //Decimation drops snapshots before any recording state sees them
+        if(samp_valid) { 
+            decimate_mode  = samp_cfg.mode;
+            decimate_every = samp_cfg.every > 1 ? samp_cfg.every : 1;
+            decimate_mask  = samp_cfg.every > 1 ? 0xFFFF >> clz((ushort) (samp_cfg.every - 1)) : 0;
+            decimate_count = 0;
+        }
+        if(read_valid & (state != D_HISTOGRAM)) { 
+        bool keep;
+            decimate_lfsr = (decimate_lfsr >> 1) | 
+                            ((((decimate_lfsr >> 0) ^ (decimate_lfsr >> 2) ^ (decimate_lfsr >> 3) ^ (decimate_lfsr >> 5)) & 1) << 15);
+            if(decimate_mode == S_RANDOM) 
+                keep = (decimate_lfsr & decimate_mask) == 0;
+            else { 
+                keep           = decimate_count == 0;
+                decimate_count = decimate_count == decimate_every - 1 ? 0 : decimate_count + 1;
+            }
+            read_valid = keep;
+        }
+#if !DELTA_STAMPS
+        //A trigger configuration is held until the buffer stops, then arms it with an empty history
+        if(cfg_valid) { 
+            trig_held       = trig_cfg;
+            trig_held_valid = true;
+        }
+        if(trig_held_valid & (state == D_STOP)) { 
+            trig_mode       = trig_held.mode;
+            trig_value      = trig_held.value;
+            trig_interval   = trig_held.interval;
+            trig_pre        = trig_held.pre < DEBUG_SAMPLE_DEPTH - 1 ? trig_held.pre : DEBUG_SAMPLE_DEPTH - 1;
+            trig_post       = trig_held.post < DEBUG_SAMPLE_DEPTH - 1 - trig_pre ? 
+                              trig_held.post : DEBUG_SAMPLE_DEPTH - 1 - trig_pre;
+            trig_held_valid = false;
+            trig_before     = 0;
+            trig_after      = 0;
+            trig_fired      = false;
+            trig_last_valid = false;
+            trig_window     = true;
+            sampled_point   = 0;
+            state           = D_TRIGGER;
+        }
+#endif 
         switch(state) { 
             case D_RESET: {
                 sampled_point = 0;
                 read_count    = 0;
                 overflow      = 0;
+                stream_stop   = false;
+                flush_pending = false;
+                hist_cleared  = 0;
+                hist_count    = 0;
+                hist_max      = 0;
+                hist_valid    = false;
+                trig_window   = false;
+                decimate_count = 0;
+#if DELTA_STAMPS
+                pack_lo       = 0;
+                pack_hi       = 0;
+                pack_fill     = 0;
+                stamp_valid   = false;
+#else 
+                trig_held_valid = false;
+#endif
                 state         = DEFAULT_SAMPLING_SCHEME;
                 //printf("-INFO- DEBUG RESET COMPLETE \n");
                 break;
             }
             case D_RECORD: 
             case D_RECORD_CYCLIC: { 
+#if DELTA_STAMPS
+                //Each sample adds one delta slot or a four slot escape to pack, and every cycle a 
+                //full word of four slots moves from pack to the trace buffer, so pack never holds 
+                //more than seven slots 
+                live_lost += read_valid & (sampled_point*4 + pack_fill + 4 > DEBUG_SAMPLE_DEPTH*4);
+                if(read_valid & (sampled_point*4 + pack_fill + 4 <= DEBUG_SAMPLE_DEPTH*4)) { 
+                stamp_t delta = time_stamp - last_stamp;
+                stamp_t slots;
+                    if(stamp_valid & (delta < 0x8000)) 
+                        slots = delta;
+                    else 
+                        slots = (0x8000 | ((time_stamp >> 48) & 0x7FFF))  | 
+                                (((time_stamp >> 32) & 0xFFFF) << 16)     | 
+                                (((time_stamp >> 16) & 0xFFFF) << 32)     | 
+                                ((time_stamp & 0xFFFF) << 48);
+                    pack_lo    |= slots << (16*pack_fill);
+                    pack_hi    |= pack_fill ? slots >> (64 - 16*pack_fill) : 0;
+                    pack_fill  += (stamp_valid & (delta < 0x8000)) ? 1 : 4;
+                    last_stamp  = time_stamp;
+                    stamp_valid = true;
+                }
+                if(pack_fill >= 4) { 
+                    debug_memory[sampled_point] = pack_lo;
+                    sampled_point++;
+                    pack_lo    = pack_hi;
+                    pack_hi    = 0;
+                    pack_fill -= 4;
+                }
+#else 
+                //A full buffer drops the sample, a wrapped cyclic buffer overwrites the oldest one
+                live_lost += read_valid & ((sampled_point == DEBUG_SAMPLE_DEPTH) | overflow);
                 if(read_valid & (sampled_point < DEBUG_SAMPLE_DEPTH)) { 
                 buffer_s stamp_value;
 
@@ -49,6 +256,9 @@
                     //printf("Sampled [%0d][%0d] = %0lx\n",channel_no,index,stamp_value);
                     //debug_memory[sampled_point] = stamp_value;
                     debug_memory[sampled_point] = time_stamp;
+#if SNAPSHOT_PAYLOAD
+                    payload_memory[sampled_point] = take_stamp;
+#endif
                     sampled_point++;
                     if((state == D_RECORD_CYCLIC) & 
                        (sampled_point == DEBUG_SAMPLE_DEPTH)) { 
@@ -57,18 +267,160 @@
                     }
                         
                 }
+#endif 
+                break;
+            }
+#if !DELTA_STAMPS
+            case D_TRIGGER: { 
+                //The buffer is cyclic until the trigger fires, only the last trig_pre samples 
+                //before the trigger and trig_post samples after it are reported
+                if(read_valid) { 
+                stamp_t interval = time_stamp - trig_last;
+                uint    payload  = take_stamp;
+                bool    hit;
+                    hit = !trig_fired & (((trig_mode == T_EQUAL)    & (payload == trig_value)) | 
+                                         ((trig_mode == T_ABOVE)    & (payload >= trig_value)) | 
+                                         ((trig_mode == T_INTERVAL) & trig_last_valid & (interval > trig_interval)));
+                    debug_memory[sampled_point] = time_stamp;
+#if SNAPSHOT_PAYLOAD
+                    payload_memory[sampled_point] = take_stamp;
+#endif
+                    sampled_point   = sampled_point == DEBUG_SAMPLE_DEPTH - 1 ? 0 : sampled_point + 1;
+                    trig_last       = time_stamp;
+                    trig_last_valid = true;
+                    if(hit) 
+                        trig_fired = true;
+                    else if(trig_fired) 
+                        trig_after++;
+                    else if(trig_before < trig_pre) 
+                        trig_before++;
+                    if(trig_fired & (trig_after == trig_post)) 
+                        state = D_STOP;
+                }
+                break;
+            }
+#endif 
+            case D_RECORD_STREAM: { 
+                //Flush side, one word of the pending block per iteration 
+                if(flush_pending) { 
+                stamp_t flush_out;
+                    flush_out = flush_index == 0 ? flush_header : 
+                                debug_memory[flush_half*STREAM_BLOCK_DEPTH + flush_index - 1];
+                    if(write_channel_nb_altera(stream_stamp_c[buffer_id], flush_out)) { 
+                        if(flush_index == STREAM_BLOCK_DEPTH) { 
+                            flush_pending = false;
+                            flush_index   = 0;
+                        }
+                        else 
+                            flush_index++;
+                    }
+                    mem_fence(CLK_CHANNEL_MEM_FENCE);
+                }
+
+                //Record side, stamps are dropped while both halves are waiting for the host 
+                if(read_valid & !stream_stop) { 
+                    if(sampled_point < STREAM_BLOCK_DEPTH) { 
+                        debug_memory[stream_half*STREAM_BLOCK_DEPTH + sampled_point] = time_stamp;
+                        sampled_point++;
+                    }
+                    else { 
+                        stream_dropped++;
+                        live_lost++;
+                    }
+                }
+
+                //Hand over a full half, or the partial one on stop, once the flush side is idle.
+                //The last block is followed by DEBUG_STREAM_SLICES-1 empty last blocks, one for 
+                //each stream_stamp launch the host still has in flight 
+                if(!flush_pending) { 
+                    if(stream_stop & (flush_tail == DEBUG_STREAM_SLICES)) { 
+                        state = D_STOP;
+                    }
+                    else if(stream_stop | (sampled_point == STREAM_BLOCK_DEPTH)) { 
+                        flush_pending  = true;
+                        flush_half     = stream_half;
+                        flush_header   = (((stamp_t) stream_stop) << 63) | 
+                                         (((stamp_t) (stream_dropped & 0x7FFFFFFF)) << 32) | 
+                                         (stamp_t) sampled_point;
+                        stream_half    = 1 - stream_half;
+                        sampled_point  = 0;
+                        stream_dropped = 0;
+                        if(stream_stop) 
+                            flush_tail++;
+                    }
+                }
+                break;
+            }
+            case D_HISTOGRAM: { 
+                //Bins are cleared one per cycle after reset, stamps are not binned until then
+                if(hist_cleared < HISTOGRAM_BINS) { 
+                    histogram[hist_cleared] = 0;
+                    hist_cleared++;
+                }
+                else if(read_valid) { 
+                    if(hist_valid) { 
+                    stamp_t interval = time_stamp - hist_last;
+                    int     bin      = 64 - clz(interval);
+                        bin = bin < HISTOGRAM_BINS ? bin : HISTOGRAM_BINS - 1;
+                        histogram[bin]++;
+                        hist_count++;
+                        hist_max = interval > hist_max ? interval : hist_max;
+                    }
+                    hist_last  = time_stamp;
+                    hist_valid = true;
+                }
+                break;
+            }
+            case D_READ_HISTOGRAM: { 
+                if(read_count <= HISTOGRAM_BINS + 1) { 
+                stamp_t hist_out;
+                    hist_out = read_count == 0                  ? hist_count : 
+                               read_count == HISTOGRAM_BINS + 1 ? hist_max   : 
+                               (read_count - 1) < hist_cleared  ? histogram[read_count - 1] : 0;
+                    if(write_channel_nb_altera(read_stamp_c[buffer_id], hist_out)) 
+                        read_count++;
+                    mem_fence(CLK_CHANNEL_MEM_FENCE);
+                }
+                else { 
+                    state      = D_STOP;
+                    read_count = 0;
+                }
                 break;
             }
-            case D_READ: {
+            case D_READ: 
+            case D_READ_PAYLOAD: {
                 if(read_count <= DEBUG_SAMPLE_DEPTH) { 
                 //buffer_s ts_out;
                 stamp_t ts_out;
                 bool     write_valid;
+#if DELTA_STAMPS
+                    //Header is the number of 16-bit slots, the partial word is still in pack. 
+                    //Payloads are not kept, their read is empty
+                    if((read_count == 0) | (state == D_READ_PAYLOAD)) 
+                        ts_out = state == D_READ_PAYLOAD ? 0 : sampled_point*4 + pack_fill;
+                    else 
+                        ts_out = (read_count - 1) == sampled_point ? pack_lo : debug_memory[read_count - 1];
+#else 
+                //A trigger window ends at the last recorded sample
+                int trig_len  = trig_before + (trig_fired ? 1 + trig_after : 0);
+                int read_base = trig_window ? (sampled_point + DEBUG_SAMPLE_DEPTH - trig_len)%DEBUG_SAMPLE_DEPTH : 
+                                overflow    ? sampled_point : 0;
                     if(read_count == 0) 
                         //ts_out.lo = overflow ? DEBUG_SAMPLE_DEPTH : sampled_point;
-                        ts_out = overflow ? DEBUG_SAMPLE_DEPTH : sampled_point;
+                        ts_out = trig_window ? ((((stamp_t) (trig_fired ? trig_before + 1 : 0)) << 32) | trig_len) : 
+                                 overflow    ? DEBUG_SAMPLE_DEPTH : sampled_point;
+#if SNAPSHOT_PAYLOAD
+                    else if(state == D_READ_PAYLOAD) 
+                        ts_out  = payload_memory[(read_base + read_count - 1)%DEBUG_SAMPLE_DEPTH];
+#endif
                     else
-                        ts_out  = overflow ? debug_memory[(sampled_point + read_count - 1)%DEBUG_SAMPLE_DEPTH] : debug_memory[read_count - 1];
+                        ts_out  = debug_memory[(read_base + read_count - 1)%DEBUG_SAMPLE_DEPTH];
+#if !SNAPSHOT_PAYLOAD
+                    //Payloads are compiled out, their read is a 0 header and 0 words
+                    if(state == D_READ_PAYLOAD) 
+                        ts_out  = 0;
+#endif
+#endif 
                     //printf("Read TIme Stamp %0lu\n", ts_out);
                     write_valid = write_channel_nb_altera(read_stamp_c[buffer_id], ts_out);
                     mem_fence(CLK_CHANNEL_MEM_FENCE);
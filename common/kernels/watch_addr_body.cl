@@ -5,6 +5,9 @@
     watch_s         first_read;
     watch_s         watch_mem[WATCH_SAMPLE_DEPTH];
     bool            overflow;
+    watch_cfg_s     cfg;
+    uint            hits[WATCH_REGIONS];
+    int             hits_cleared = 0;
     #pragma acc kernels loop independent
     for(ulong infinite_counter = 0; infinite_counter < ULONG_MAX ; infinite_counter++) { 
     watch_s    data_in;
@@ -13,13 +16,26 @@
     bool       rvalid_watch;
     debug_command_e next_state;
     watch_s     addr_read;
+    watch_cfg_s cfg_read;
+    bool        rvalid_cfg;
         addr_read.addr  = read_channel_nb_altera(addr_in_c[watch_id],   &rvalid_addr);
+        cfg_read        = read_channel_nb_altera(watch_cfg_c[watch_id], &rvalid_cfg);
         next_state      = read_channel_nb_altera(watch_cmd_c[watch_id], &rvalid_cmd);
         data_in         = read_channel_nb_altera(watch_in_c[watch_id],  &rvalid_watch);
 
         if(rvalid_addr) {
-            watch_enable = true;
-            first_read   = addr_read;
+            watch_enable     = true;
+            first_read       = addr_read;
+            cfg.base         = addr_read.addr;
+            cfg.limit        = 0;
+            cfg.mode         = W_EXACT;
+            cfg.region_shift = 0;
+        }
+
+        if(rvalid_cfg) { 
+            watch_enable    = true;
+            first_read.addr = cfg_read.base;
+            cfg             = cfg_read;
         }
 
         if(rvalid_cmd) { 
@@ -46,11 +62,28 @@
                 index = 0;
                 read_pointer = 0;
                 overflow = 0;
+                hits_cleared = 0;
                 break;
             case D_RECORD : 
             case D_RECORD_CYCLIC : 
-                if(rvalid_watch & watch_enable & (index < WATCH_SAMPLE_DEPTH)) { 
-                    if(data_in.addr == first_read.addr) { 
+                //Hit counters are cleared one per cycle after reset 
+                if(hits_cleared < WATCH_REGIONS) { 
+                    hits[hits_cleared] = 0;
+                    hits_cleared++;
+                }
+                if(rvalid_watch & watch_enable) { 
+                bool match;
+                uint offset;
+                uint region;
+                    match  = cfg.mode == W_RANGE ? (data_in.addr >= cfg.base) & (data_in.addr < cfg.limit) : 
+                             cfg.mode == W_MASK  ? ((data_in.addr ^ cfg.base) & cfg.limit) == 0 : 
+                                                   data_in.addr == cfg.base; 
+                    offset = cfg.mode == W_MASK ? data_in.addr & ~cfg.limit : data_in.addr - cfg.base;
+                    region = offset >> cfg.region_shift;
+                    region = region < WATCH_REGIONS ? region : WATCH_REGIONS - 1;
+                    if(match & (hits_cleared == WATCH_REGIONS) & (hits[region] != 0xFFFFFFFF)) 
+                        hits[region]++;
+                    if(match & (index < WATCH_SAMPLE_DEPTH)) { 
                         watch_mem[index].addr = get_time(data_in.tag);
                         watch_mem[index].tag  = data_in.tag;
                         index++;
@@ -62,13 +95,18 @@
                 }
                 break;
             case D_READ : { 
-                if(read_pointer <= WATCH_SAMPLE_DEPTH+1) { 
+                if(read_pointer < WATCH_READ_DEPTH) { 
                     bool     wvalid;
                     watch_s out_data;
                     watch_s depth;
-                    depth.tag = overflow ? WATCH_SAMPLE_DEPTH : index;
+                    watch_s region_hits;
+                    int     region = read_pointer - WATCH_SAMPLE_DEPTH - 2;
+                    depth.tag        = overflow ? WATCH_SAMPLE_DEPTH : index;
+                    region_hits.addr = (region >= 0) & (region < hits_cleared) ? hits[region] : 0;
+                    region_hits.tag  = region;
                     out_data = read_pointer == 0 ? first_read : 
                                read_pointer == 1 ? depth : 
+                               region >= 0       ? region_hits : 
                                (overflow ? watch_mem[(index + read_pointer - 2)%WATCH_SAMPLE_DEPTH] : watch_mem[read_pointer - 2]); 
                     wvalid = write_channel_nb_altera(watch_out_c[watch_id],out_data); 
                     if(wvalid) 
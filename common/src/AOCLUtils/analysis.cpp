@@ -0,0 +1,104 @@
+#ifndef ANALYSIS_CPP
+#define ANALYSIS_CPP
+
+#include "AOCLUtils/analysis.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+int analyze_trace_point(const stamp_t*  samples
+                       ,const size_t    count
+                       ,const double    clock_mhz
+                       ,const double    stall_factor
+                       ,trace_stats_s*  stats) { 
+    const cl_uint point = stats->point;
+    memset(stats,0,sizeof(trace_stats_s));
+    stats->point   = point;
+    stats->samples = count;
+    if(count < 2) 
+        return -1;
+
+    const size_t intervals = count - 1;
+    stamp_t*     sorted    = (stamp_t *) malloc(sizeof(stamp_t)*intervals);
+    if(sorted == NULL) { 
+        printf("-ERROR- Could not allocate trace analysis buffer\n");
+        return -1;
+    }
+    for(size_t i = 0; i < intervals; i++) 
+        sorted[i] = samples[i + 1] - samples[i];
+    std::nth_element(sorted,sorted + intervals/2,sorted + intervals);
+    stats->median_ii = (double) sorted[intervals/2];
+    free(sorted);
+
+    //Anything longer than the threshold is a stall, a zero median still flags gaps
+    const double threshold = stall_factor*(stats->median_ii > 0.0 ? stats->median_ii : 1.0);
+
+    //Warm-up lasts until WARMUP_WINDOW intervals in a row are not stalled
+    size_t steady = 0;
+    size_t run    = 0;
+    for(size_t i = 0; i < intervals; i++) { 
+        run = (samples[i + 1] - samples[i]) > threshold ? 0 : run + 1;
+        if(run == WARMUP_WINDOW) { 
+            steady = i + 1 - WARMUP_WINDOW;
+            break;
+        }
+    }
+    if(run < WARMUP_WINDOW) 
+        steady = 0;     //Never settled, analyze everything
+    stats->warmup_samples = steady;
+    stats->warmup_cycles  = samples[steady] - samples[0];
+
+    bool in_stall = false;
+    for(size_t i = steady; i < intervals; i++) { 
+    const stamp_t interval = samples[i + 1] - samples[i];
+        if(interval > threshold) { 
+            stats->stalls       += in_stall ? 0 : 1;
+            stats->stall_cycles += interval - (stamp_t) stats->median_ii;
+            stats->longest_stall = interval > stats->longest_stall ? interval : stats->longest_stall;
+            in_stall             = true;
+        }
+        else 
+            in_stall = false;
+    }
+
+    const stamp_t steady_cycles    = samples[count - 1] - samples[steady];
+    const size_t  steady_intervals = intervals - steady;
+    const double  mhz              = clock_mhz > 0.0 ? clock_mhz : 
+                                     get_debug_clock()->valid ? get_debug_clock()->clock_mhz : 0.0;
+    stats->achieved_ii        = (double) steady_cycles/steady_intervals;
+    stats->stalled_fraction   = steady_cycles ? (double) stats->stall_cycles/steady_cycles : 0.0;
+    stats->iterations_per_sec = (steady_cycles && mhz > 0.0) ? steady_intervals*mhz*1e6/steady_cycles : 0.0;
+    return 0;
+}
+
+void analyze_trace(const stamp_t*  time_stamp
+                  ,const double    clock_mhz
+                  ,trace_stats_s*  stats) { 
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+    const stamp_t* buffer = time_stamp + j*(DEBUG_TRACE_DEPTH+1);
+    const size_t   count  = TRACE_COUNT(buffer[0]) < DEBUG_TRACE_DEPTH ? TRACE_COUNT(buffer[0]) : DEBUG_TRACE_DEPTH;
+        stats[j].point = j;
+        analyze_trace_point(buffer + 1,count,clock_mhz,STALL_FACTOR,&stats[j]);
+    }
+}
+
+void print_trace_stats(const trace_stats_s* stats
+                      ,const int            num_points
+                      ,FILE*                out) { 
+    for(int j = 0; j < num_points; j++) { 
+    const trace_stats_s* s = &stats[j];
+        if(s->samples < 2) { 
+            fprintf(out,"-INFO- point %u: %lu samples, nothing to analyze\n", s->point, (unsigned long) s->samples);
+            continue;
+        }
+        fprintf(out,"-INFO- point %u: achieved II=%.2f (median %.0f), %.1f%% stalled cycles in %lu stalls "
+                    "(longest %lu), warm-up %lu samples / %lu cycles", 
+                s->point, s->achieved_ii, s->median_ii, 100.0*s->stalled_fraction, (unsigned long) s->stalls, 
+                (unsigned long) s->longest_stall, (unsigned long) s->warmup_samples, (unsigned long) s->warmup_cycles);
+        if(s->iterations_per_sec > 0.0) 
+            fprintf(out,", %.3g iterations/s", s->iterations_per_sec);
+        fprintf(out,"\n");
+    }
+}
+
+#endif //ANALYSIS_CPP
@@ -2,7 +2,199 @@
 #define DEBUG_CPP
 
 #include "AOCLUtils/debug.h"
+#include "AOCLUtils/trace.h"
+#include "AOCLUtils/monitor.h"
+#include "AOCLUtils/opencl.h"
 #include "CL/opencl.h"
+#include <sys/time.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Trace readout buffers, allocated once and reused by every read_debug call */
+static cl_mem   trace_read_buffer = NULL;
+static stamp_t* trace_host_buffer = NULL;
+#if DELTA_STAMPS
+static stamp_t* trace_decoded_buffer = NULL;
+#endif
+static cl_uint* trace_payload_buffer = NULL;
+
+/* Watch readout buffer, allocated once and reused by every read_watch call */
+static cl_mem   watch_read_buffer = NULL;
+
+static void alloc_trace_buffers(const cl_context context) { 
+#if NUM_DEBUG_POINTS > 0
+    cl_int status;
+    const cl_int mem_size = NUM_DEBUG_POINTS*(DEBUG_SAMPLE_DEPTH+1);
+
+    if(trace_read_buffer == NULL) { 
+        trace_read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t)*mem_size, NULL, &status);
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not create trace read buffer\n");
+            trace_read_buffer = NULL;
+        }
+    }
+    if(trace_host_buffer == NULL) { 
+        if(posix_memalign ((void **) &trace_host_buffer,64,sizeof(stamp_t)*mem_size) != 0) { 
+            printf("-ERROR- Could not allocate trace host buffer\n");
+            trace_host_buffer = NULL;
+        }
+    }
+    if(trace_payload_buffer == NULL) { 
+        if(posix_memalign ((void **) &trace_payload_buffer,64,sizeof(cl_uint)*mem_size) != 0) { 
+            printf("-ERROR- Could not allocate trace payload buffer\n");
+            trace_payload_buffer = NULL;
+        }
+    }
+#if DELTA_STAMPS
+    if(trace_decoded_buffer == NULL) { 
+        if(posix_memalign ((void **) &trace_decoded_buffer,64,sizeof(stamp_t)*NUM_DEBUG_POINTS*(DEBUG_TRACE_DEPTH+1)) != 0) { 
+            printf("-ERROR- Could not allocate decoded trace buffer\n");
+            trace_decoded_buffer = NULL;
+        }
+    }
+#endif 
+#endif 
+}
+
+/* Trace buffers streaming into host memory, set by start_stream_debug until stop_stream_debug */
+static cl_uint streaming_mask = 0;
+
+/* set_trigger kernel, created by init_debug and launched on the read_stamp queue */
+static cl_kernel trigger_kernel = NULL;
+
+/* set_sampling kernel, created by init_debug and launched on the read_stamp queue */
+static cl_kernel sampling_kernel = NULL;
+
+#if NUM_CHANNEL_STATS > 0
+/* read_channel_stats kernel with its own queue, created by init_debug */
+static cl_command_queue stats_queue       = NULL;
+static cl_kernel        stats_kernel      = NULL;
+static cl_mem           stats_read_buffer = NULL;
+static stamp_t          stats_host_buffer[NUM_CHANNEL_STATS*CHANNEL_STAT_WORDS];
+#endif
+
+/* Device stamp to host clock mapping measured by init_debug */
+static debug_clock_s debug_clock = { false, 0.0, 0.0, 0.0 };
+
+#if NUM_DEBUG_POINTS > 0
+/* Fit the free running counter against the profiling clock of a read_time task, and the 
+ * profiling clock against the host clock through the queued time of the same task */
+static void calibrate_debug_clock(const cl_context         context
+                                 ,const cl_program         program
+                                 ,const cl_command_queue   queue) { 
+    cl_int    status;
+    cl_kernel kernel;
+    cl_mem    time_buffer;
+    stamp_t   stamp     [DEBUG_CALIBRATION_SAMPLES];
+    cl_ulong  prof_mid  [DEBUG_CALIBRATION_SAMPLES];
+    double    host_off  [DEBUG_CALIBRATION_SAMPLES];
+    double    host_err  [DEBUG_CALIBRATION_SAMPLES];
+
+    debug_clock.valid = false;
+    kernel = clCreateKernel(program,"read_time",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-WARN- No read_time kernel, trace stamps are not calibrated\n");
+        return;
+    }
+    time_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t), NULL, &status);
+    status |= clSetKernelArg(kernel,0,sizeof(cl_mem),&time_buffer);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not set up clock calibration\n");
+        clReleaseKernel(kernel);
+        return;
+    }
+
+    for(int i = 0; i < DEBUG_CALIBRATION_SAMPLES; i++) { 
+    cl_event done;
+    cl_ulong queued, start, end;
+    double   before, after;
+        before = aocl_utils::getCurrentTimestamp();
+        status = clEnqueueTask(queue,kernel,0,NULL,&done);
+        after  = aocl_utils::getCurrentTimestamp();
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not Enqueue Kernel %s\n","read_time");
+            break;
+        }
+        status  = clEnqueueReadBuffer(queue,time_buffer,CL_TRUE,0,sizeof(stamp_t),&stamp[i],0,NULL,NULL);
+        status |= clGetEventProfilingInfo(done,CL_PROFILING_COMMAND_QUEUED,sizeof(cl_ulong),&queued,NULL);
+        status |= clGetEventProfilingInfo(done,CL_PROFILING_COMMAND_START ,sizeof(cl_ulong),&start ,NULL);
+        status |= clGetEventProfilingInfo(done,CL_PROFILING_COMMAND_END   ,sizeof(cl_ulong),&end   ,NULL);
+        clReleaseEvent(done);
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not read clock calibration sample\n");
+            break;
+        }
+        prof_mid[i] = start + (end - start)/2;
+        host_off[i] = 0.5*(before + after) - queued*1e-9;
+        host_err[i] = 0.5*(after - before) + 0.5*(end - start)*1e-9;
+        if(i == DEBUG_CALIBRATION_SAMPLES - 1) { 
+            debug_clock.valid = true;
+        }
+        else 
+            aocl_utils::waitMilliseconds(DEBUG_CALIBRATION_INTERVAL_MS);
+    }
+    clReleaseMemObject(time_buffer);
+    clReleaseKernel(kernel);
+    if(!debug_clock.valid) 
+        return;
+
+    //Profiling to host offset of the sample with the tightest host bracket, also used for energy
+    const int n = DEBUG_CALIBRATION_SAMPLES;
+    int best = 0;
+    for(int i = 1; i < n; i++) 
+        if(host_err[i] < host_err[best]) best = i;
+    set_profiling_offset(host_off[best]);
+
+    //Least squares of profiling ns against cycles, relative to the first sample
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for(int i = 0; i < n; i++) { 
+    double x = (double) (stamp[i] - stamp[0]);
+    double y = (double) (cl_long) (prof_mid[i] - prof_mid[0]);
+        sx += x; sy += y; sxx += x*x; sxy += x*y;
+    }
+    double var = n*sxx - sx*sx;
+    if(var <= 0.0) { 
+        printf("-WARN- Trace time stamps do not advance, trace stamps are not calibrated\n");
+        debug_clock.valid = false;
+        return;
+    }
+    double ns_per_cycle = (n*sxy - sx*sy)/var;
+    double intercept    = (sy - ns_per_cycle*sx)/n;
+    if(ns_per_cycle <= 0.0) { 
+        printf("-WARN- Trace time stamps run backwards, trace stamps are not calibrated\n");
+        debug_clock.valid = false;
+        return;
+    }
+
+    debug_clock.clock_mhz      = 1e3/ns_per_cycle;
+    debug_clock.host_at_cycle0 = host_off[best] + prof_mid[0]*1e-9 
+                               + (intercept - ns_per_cycle*(double) stamp[0])*1e-9;
+    debug_clock.error_us       = host_err[best]*1e6;
+    printf("-INFO- Trace clock %.3f MHz, host aligned within %.2f us\n", debug_clock.clock_mhz, debug_clock.error_us);
+}
+#endif 
+
+const debug_clock_s* get_debug_clock() { 
+    return &debug_clock;
+}
+
+double debug_stamp_to_host(const stamp_t stamp) { 
+    return debug_clock.host_at_cycle0 + stamp/(debug_clock.clock_mhz*1e6);
+}
+
+#ifdef EMULATOR
+/* Kernel name prefix followed by id, or prefix alone for a negative id. Freed by the caller */
+static char* emulator_kernel_name(const char* prefix, const int id) { 
+    int   length = id < 0 ? snprintf(NULL,0,"%s",prefix) : snprintf(NULL,0,"%s%0d",prefix,id);
+    char* name   = (char*) malloc(length + 1);
+    if(id < 0) 
+        snprintf(name,length + 1,"%s",prefix);
+    else 
+        snprintf(name,length + 1,"%s%0d",prefix,id);
+    return name;
+}
+#endif 
 
 void init_debug(const cl_context         context
                ,const cl_program         program
@@ -14,17 +206,20 @@ void init_debug(const cl_context         context
     cl_int status;
 #ifdef EMULATOR 
     #pragma message "compiling debug for emulator"
-    char debug_kernel_names[ NUM_WATCH_POINTS + NUM_DEBUG_POINTS + 2 ][30];
+    char** debug_kernel_names;
 
-    sprintf(debug_kernel_names[0],"read_stamp");
-    sprintf(debug_kernel_names[1],"read_watch");
+    no_of_kernels      = 2 + NUM_DEBUG_POINTS + NUM_WATCH_POINTS + NUM_CHANNEL_STATS;
+    debug_kernel_names = (char**) malloc(sizeof(char*) * no_of_kernels);
+    debug_kernel_names[0] = emulator_kernel_name("read_stamp",-1);
+    debug_kernel_names[1] = emulator_kernel_name("read_watch",-1);
     for(int i = 2; i < NUM_DEBUG_POINTS + 2; i++) 
-        sprintf(debug_kernel_names[i], "sample_stamp_%0d", i-2); 
+        debug_kernel_names[i] = emulator_kernel_name("sample_stamp_", i - 2); 
 
     for(int i = NUM_DEBUG_POINTS + 2; i < 2 + NUM_DEBUG_POINTS + NUM_WATCH_POINTS ; i++) 
-        sprintf(debug_kernel_names[i], "watch_addr_%0d", i - 2 - NUM_DEBUG_POINTS); 
+        debug_kernel_names[i] = emulator_kernel_name("watch_addr_", i - 2 - NUM_DEBUG_POINTS); 
 
-    no_of_kernels = 2 + NUM_DEBUG_POINTS + NUM_WATCH_POINTS;
+    for(int i = 2 + NUM_DEBUG_POINTS + NUM_WATCH_POINTS; i < no_of_kernels ; i++) 
+        debug_kernel_names[i] = emulator_kernel_name("channel_stat_", i - 2 - NUM_DEBUG_POINTS - NUM_WATCH_POINTS); 
 #else 
     const char* debug_kernel_names[] = {"read_stamp","read_watch"};
     no_of_kernels = 2;
@@ -41,6 +236,18 @@ void init_debug(const cl_context         context
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not create kernel in debug %0d\n", debug_kernel_names[0]);
     }
+    trigger_kernel = clCreateKernel(program,"set_trigger",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-WARN- No set_trigger kernel, trace triggers are disabled\n");
+        trigger_kernel = NULL;
+    }
+    sampling_kernel = clCreateKernel(program,"set_sampling",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-WARN- No set_sampling kernel, trace decimation is disabled\n");
+        sampling_kernel = NULL;
+    }
+    alloc_trace_buffers(context);
+    calibrate_debug_clock(context,program,(*queue)[0]);
 #endif 
 
 #if NUM_WATCH_POINTS > 0
@@ -54,8 +261,23 @@ void init_debug(const cl_context         context
     }
 #endif
 
+#if NUM_CHANNEL_STATS > 0
+    stats_queue = clCreateCommandQueue(context,device,CL_QUEUE_PROFILING_ENABLE,&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create queue in debug %s\n", "read_channel_stats");
+    }
+    stats_kernel = clCreateKernel(program,"read_channel_stats",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create kernel in debug %s\n", "read_channel_stats");
+    }
+    stats_read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t)*NUM_CHANNEL_STATS*CHANNEL_STAT_WORDS, NULL, &status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create channel stat read buffer\n");
+    }
+#endif 
+
 #ifdef EMULATOR 
-    for(int i = 2; i < 2 + NUM_DEBUG_POINTS + NUM_WATCH_POINTS ; i++) { 
+    for(int i = 2; i < no_of_kernels ; i++) { 
         (*queue)[i] = clCreateCommandQueue(context,device,CL_QUEUE_PROFILING_ENABLE,&status);
         if(status != CL_SUCCESS) { 
             printf("-ERROR- Could not create queue in debug %0d\n", i);
@@ -71,6 +293,9 @@ void init_debug(const cl_context         context
         else 
             printf("-INFO- : Launched Kernel %s\n", debug_kernel_names[i]);
     }
+    for(int i = 0; i < no_of_kernels; i++) 
+        free(debug_kernel_names[i]);
+    free(debug_kernel_names);
 #endif 
 
 }
@@ -78,32 +303,60 @@ void init_debug(const cl_context         context
 void reset_debug_all_buffers(const cl_kernel*        kernel
                             ,const cl_command_queue* queue) {
 
-    for(int trace_buffer_id = 0; trace_buffer_id <  NUM_DEBUG_POINTS ; trace_buffer_id++) { 
-        reset_debug(kernel,queue,trace_buffer_id);
+    cl_event done = control_buffers_async(kernel,queue,DEBUG_POINTS_MASK,D_RESET,0,NULL);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
     }
 }
 
-void control_buffer(const cl_kernel*        kernel
-                   ,const cl_command_queue* queue
-                   ,const cl_int            buffer_id
-                   ,const debug_command_e   cmd) {
-
-    cl_int status;
-    cl_int cmd_in = (cl_int) cmd;
+cl_event control_buffers_async(const cl_kernel*        kernel
+                              ,const cl_command_queue* queue
+                              ,const cl_uint           buffer_mask
+                              ,const debug_command_e   cmd
+                              ,const cl_uint           num_events_in_wait_list
+                              ,const cl_event*         event_wait_list) {
+
+    cl_int   status;
+    cl_event done      = NULL;
+    cl_int   cmd_in    = (cl_int) cmd;
+    cl_uint  no_buffer = NUM_DEBUG_POINTS;  //Buffers are addressed only through the mask
+    cl_uint  mask      = buffer_mask;
+
+    //A reset or read would end a stream under the drains in flight, only stop_stream_debug ends it
+    if((cmd == D_RESET) | (cmd == D_READ) | (cmd == D_READ_PAYLOAD) | (cmd == D_READ_HISTOGRAM)) 
+        mask &= ~streaming_mask;
+    if(mask == 0) 
+        return NULL;
 
     status  = clSetKernelArg(kernel[0],0,sizeof(cl_int),&cmd_in);
     status |= clSetKernelArg(kernel[0],1,sizeof(cl_mem),NULL);
-    status |= clSetKernelArg(kernel[0],2,sizeof(cl_int),&buffer_id); 
+    status |= clSetKernelArg(kernel[0],2,sizeof(cl_uint),&no_buffer); 
+    status |= clSetKernelArg(kernel[0],3,sizeof(cl_uint),&mask); 
 
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not set the kernel arguments");
     }
 
-    status = clEnqueueTask(queue[0],kernel[0],0,NULL,NULL);
+    status = clEnqueueTask(queue[0],kernel[0],num_events_in_wait_list,event_wait_list,&done);
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not Enqueue Kernel");
+        return NULL;
+    }
+    clFlush(queue[0]);
+    return done;
+}
+
+void control_buffer(const cl_kernel*        kernel
+                   ,const cl_command_queue* queue
+                   ,const cl_int            buffer_id
+                   ,const debug_command_e   cmd) {
+
+    cl_event done = control_buffers_async(kernel,queue,1u << buffer_id,cmd,0,NULL);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
     }
-    clFinish(queue[0]);
 }
 
 
@@ -137,97 +390,198 @@ void start_cyclic_debug(const cl_kernel*          kernel
     control_buffer(kernel,queue,buffer_id,D_RECORD_CYCLIC);
 }
 
+cl_event arm_trigger_async(const cl_kernel*        kernel
+                          ,const cl_command_queue* queue
+                          ,const cl_uint           buffer_mask
+                          ,const trigger_mode_e    mode
+                          ,const cl_uint           value
+                          ,const cl_uint           interval
+                          ,const cl_ushort         pre
+                          ,const cl_ushort         post) { 
+    cl_int   status;
+    cl_event stopped;
+    cl_event done    = NULL;
+    cl_uchar mode_in = (cl_uchar) mode;
+
+    if(trigger_kernel == NULL) { 
+        printf("-ERROR- Trace triggers are not available\n");
+        return NULL;
+    }
+#if DELTA_STAMPS
+    printf("-ERROR- Trace triggers are not available with DELTA_STAMPS\n");
+    return NULL;
+#endif 
+    //A streaming buffer only stops through stop_stream_debug, it would never take the trigger
+    if(buffer_mask & streaming_mask) { 
+        printf("-ERROR- Trace buffers are streaming, stop_stream_debug before arming a trigger\n");
+        return NULL;
+    }
+    //The trigger configuration is held until the buffer stops
+    stopped = control_buffers_async(kernel,queue,buffer_mask,D_STOP,0,NULL);
+    if(stopped == NULL) 
+        return NULL;
+
+    status  = clSetKernelArg(trigger_kernel,0,sizeof(cl_uint)  ,&buffer_mask);
+    status |= clSetKernelArg(trigger_kernel,1,sizeof(cl_uchar) ,&mode_in);
+    status |= clSetKernelArg(trigger_kernel,2,sizeof(cl_uint)  ,&value);
+    status |= clSetKernelArg(trigger_kernel,3,sizeof(cl_uint)  ,&interval);
+    status |= clSetKernelArg(trigger_kernel,4,sizeof(cl_ushort),&pre);
+    status |= clSetKernelArg(trigger_kernel,5,sizeof(cl_ushort),&post);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not set the kernel arguments");
+    }
 
-void read_debug(const cl_context         context
-               ,const cl_program         program
-               ,const cl_kernel*         kernel
-               ,const cl_command_queue*  queue
-               ,const cl_int             buffer_id
-               ,stamp_t**                time_stamp) {
-
-    cl_mem read_buffer;
-    cl_int status;
-
-    const cl_int mem_size = DEBUG_SAMPLE_DEPTH + 1;
-
-    posix_memalign ((void **) time_stamp,64,sizeof(stamp_t)*mem_size);
-
-    for(cl_uint i = 0; i < 1 ; i++) { 
-    char   *kernel_name;
-    size_t  kernel_name_size;
-    cl_uint kernel_arg_size;
-    char    message[200];
-        status = clGetKernelInfo(kernel[i]
-                                ,CL_KERNEL_FUNCTION_NAME ,0 , NULL, &kernel_name_size);
-
-        sprintf(message,"Could not get info on kernel in %s", "read_stamp");
-        if(status != CL_SUCCESS) printf("%s %d",message,status);   
-     
-        kernel_name = (char *) malloc(sizeof(char) * kernel_name_size);
-
-        status = clGetKernelInfo(kernel[i]
-                                ,CL_KERNEL_FUNCTION_NAME 
-                                ,sizeof(char)*kernel_name_size
-                                ,kernel_name
-                                ,NULL );
-        sprintf(message,"Could not get info on kernel in %s", kernel_name);
-        if(status != CL_SUCCESS) printf("%s %d",message,status);   
-        fflush(stdout);
-
-        status = clGetKernelInfo(kernel[i]
-                                ,CL_KERNEL_NUM_ARGS 
-                                ,sizeof(cl_uint)
-                                ,&kernel_arg_size
-                                ,NULL );
-        sprintf(message,"Could not get info on kernel in %s", kernel_name);
-        if(status != CL_SUCCESS) printf("%s %d",message,status);   
-
-        printf("Kernel %s has %0d args\n", kernel_name, kernel_arg_size);
-        fflush(stdout);
+    status = clEnqueueTask(queue[0],trigger_kernel,1,&stopped,&done);
+    clReleaseEvent(stopped);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not Enqueue Kernel %s\n","set_trigger");
+        return NULL;
     }
+    clFlush(queue[0]);
+    return done;
+}
 
+void start_trigger_debug(const cl_kernel*          kernel
+                        ,const cl_command_queue*   queue
+                        ,const cl_int              buffer_id
+                        ,const trigger_mode_e      mode
+                        ,const cl_uint             value
+                        ,const cl_uint             interval
+                        ,const cl_ushort           pre
+                        ,const cl_ushort           post) { 
+
+    cl_event done = arm_trigger_async(kernel,queue,1u << buffer_id,mode,value,interval,pre,post);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
+    }
+}
 
-    read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t)*mem_size, NULL, &status);
+cl_event set_sampling_async(const cl_kernel*        kernel
+                           ,const cl_command_queue* queue
+                           ,const cl_uint           buffer_mask
+                           ,const sampling_mode_e   mode
+                           ,const cl_ushort         every) { 
+    cl_int   status;
+    cl_event done    = NULL;
+    cl_uchar mode_in = (cl_uchar) mode;
+
+    if(sampling_kernel == NULL) { 
+        printf("-ERROR- Trace decimation is not available\n");
+        return NULL;
+    }
+    status  = clSetKernelArg(sampling_kernel,0,sizeof(cl_uint)  ,&buffer_mask);
+    status |= clSetKernelArg(sampling_kernel,1,sizeof(cl_uchar) ,&mode_in);
+    status |= clSetKernelArg(sampling_kernel,2,sizeof(cl_ushort),&every);
     if(status != CL_SUCCESS) { 
-        printf("-ERROR- Could not create read buffer in rest_debug\n");
+        printf("-ERROR- Could not set the kernel arguments");
     }
-    
-    status = clSetKernelArg(kernel[0],1,sizeof(cl_mem) ,&read_buffer);
 
+    status = clEnqueueTask(queue[0],sampling_kernel,0,NULL,&done);
     if(status != CL_SUCCESS) { 
-        printf("-ERROR- Could not set argument[1] for  Kernel %s %d\n","read_stamp", status);
-        fflush(stdout);
+        printf("-ERROR- Could not Enqueue Kernel %s\n","set_sampling");
+        return NULL;
     }
+    clFlush(queue[0]);
+    return done;
+}
+
+void set_sampling_debug(const cl_kernel*          kernel
+                       ,const cl_command_queue*   queue
+                       ,const cl_int              buffer_id
+                       ,const sampling_mode_e     mode
+                       ,const cl_ushort           every) { 
+
+    cl_event done = set_sampling_async(kernel,queue,1u << buffer_id,mode,every);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
+    }
+}
 
-    cl_int cmd_in = D_READ;
-    status = clSetKernelArg(kernel[0],0,sizeof(cl_int) ,&cmd_in);
 
+/* Launch read_stamp with cmd for buffer_id (or ALL_DEBUG_POINTS) and copy mem_size stamps 
+ * into trace_host_buffer with a single wait on the non-blocking read */
+static void read_trace_buffers(const cl_context         context
+                              ,const cl_kernel*         kernel
+                              ,const cl_command_queue*  queue
+                              ,const debug_command_e    cmd
+                              ,const cl_uint            buffer_id
+                              ,const cl_int             mem_size) { 
+    cl_int   status;
+    cl_event read_done;
+    cl_event copy_done;
+    cl_uint  no_mask = 0;
+
+    alloc_trace_buffers(context);
+
+    //A streaming buffer never answers the read, the read_stamp launch would not return
+    if(buffer_id == ALL_DEBUG_POINTS ? streaming_mask != 0 : (streaming_mask >> buffer_id) & 1) { 
+        printf("-ERROR- Trace buffers are streaming, stop_stream_debug before reading them\n");
+        if(trace_host_buffer != NULL) 
+            memset(trace_host_buffer,0,sizeof(stamp_t)*mem_size);
+        return;
+    }
+
+    cl_int cmd_in = (cl_int) cmd;
+    status  = clSetKernelArg(kernel[0],0,sizeof(cl_int) ,&cmd_in);
+    status |= clSetKernelArg(kernel[0],1,sizeof(cl_mem) ,&trace_read_buffer);
+    status |= clSetKernelArg(kernel[0],2,sizeof(cl_uint),&buffer_id);
+    status |= clSetKernelArg(kernel[0],3,sizeof(cl_uint),&no_mask);
     if(status != CL_SUCCESS) { 
-        printf("-ERROR- Could not set argument[0] for  Kernel %s %d\n","read_stamp", status);
+        printf("-ERROR- Could not set arguments for  Kernel %s %d\n","read_stamp", status);
         fflush(stdout);
     }
-    clSetKernelArg(kernel[0],2,sizeof(cl_int),&buffer_id);
 
-    status = clEnqueueTask(queue[0],kernel[0],0,NULL,NULL);
+    status = clEnqueueTask(queue[0],kernel[0],0,NULL,&read_done);
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not Enqueue Kernel %s\n","read_stamp");
         fflush(stdout);
+        return;
     }
-    clFinish(queue[0]);
 
 	status = clEnqueueReadBuffer(queue[0],
-                                 read_buffer,
-                                 CL_TRUE,
+                                 trace_read_buffer,
+                                 CL_FALSE,
                                  0,
 			                     sizeof(stamp_t) * mem_size,
-                                 *time_stamp,
-                                 0,
-                                 NULL,
-                                 NULL);
+                                 trace_host_buffer,
+                                 1,
+                                 &read_done,
+                                 &copy_done);
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not read buffer from Kernel\n");
+        clReleaseEvent(read_done);
+        return;
     }
-    clFinish(queue[0]);
+    clWaitForEvents(1,&copy_done);
+    clReleaseEvent(read_done);
+    clReleaseEvent(copy_done);
+}
+
+void read_debug(const cl_context         context
+               ,const cl_program         program
+               ,const cl_kernel*         kernel
+               ,const cl_command_queue*  queue
+               ,const cl_int             buffer_id
+               ,stamp_t**                time_stamp) {
+
+    posix_memalign ((void **) time_stamp,64,sizeof(stamp_t)*(DEBUG_TRACE_DEPTH+1));
+
+#if NUM_DEBUG_POINTS > 0
+    const cl_int mem_size = DEBUG_SAMPLE_DEPTH + 1;
+
+    read_trace_buffers(context,kernel,queue,D_READ,(cl_uint) buffer_id,mem_size);
+#if DELTA_STAMPS
+    decode_delta_stamps(trace_host_buffer,*time_stamp);
+#else 
+    memcpy(*time_stamp,trace_host_buffer,sizeof(stamp_t)*mem_size);
+#endif 
+#else 
+    //No trace buffers to read, an empty trace
+    printf("-ERROR- No trace buffers, NUM_DEBUG_POINTS is 0\n");
+    memset(*time_stamp,0,sizeof(stamp_t)*(DEBUG_TRACE_DEPTH+1));
+#endif 
     fflush(stdout);
 }
 
@@ -241,44 +595,771 @@ void read_debug_all_buffers(const cl_context         context
     fflush(stdout);
     const cl_int mem_size = NUM_DEBUG_POINTS*(DEBUG_SAMPLE_DEPTH+1);
 
-    posix_memalign ((void **) time_stamp,64,sizeof(stamp_t)*mem_size);
+    read_trace_buffers(context,kernel,queue,D_READ,ALL_DEBUG_POINTS,mem_size);
+#if DELTA_STAMPS
     for(int trace_buffer = 0; trace_buffer < NUM_DEBUG_POINTS ; trace_buffer++) { 
-    stamp_t *time_stamp_buffer;
-
-        //printf("-INFO- Reading TraceBuffer[%0d]\n", trace_buffer);
-        //fflush(stdout);
-        read_debug( context ,program ,kernel ,queue ,trace_buffer ,&time_stamp_buffer);
-        for(int sample_id = 0; sample_id <= DEBUG_SAMPLE_DEPTH; sample_id++) { 
-            (*time_stamp)[trace_buffer*(DEBUG_SAMPLE_DEPTH+1) + sample_id] = time_stamp_buffer[sample_id];
-            //printf("-INFO- Reading TraceBuffer[%0d]\n", trace_buffer);
-            //fflush(stdout);
+        decode_delta_stamps(trace_host_buffer    + trace_buffer*(DEBUG_SAMPLE_DEPTH+1)
+                           ,trace_decoded_buffer + trace_buffer*(DEBUG_TRACE_DEPTH+1));
+    }
+    *time_stamp = trace_decoded_buffer;
+#else 
+    *time_stamp = trace_host_buffer;
+#endif 
+}
+
+void read_payload_all_buffers(const cl_context         context
+                             ,const cl_kernel*         kernel
+                             ,const cl_command_queue*  queue
+                             ,cl_uint**                payload) { 
+
+    const cl_int mem_size = NUM_DEBUG_POINTS*(DEBUG_SAMPLE_DEPTH+1);
+
+    read_trace_buffers(context,kernel,queue,D_READ_PAYLOAD,ALL_DEBUG_POINTS,mem_size);
+    for(int i = 0; i < mem_size; i++) { 
+        trace_payload_buffer[i] = (cl_uint) TRACE_COUNT(trace_host_buffer[i]);
+    }
+    *payload = trace_payload_buffer;
+}
+
+int decode_delta_stamps(const stamp_t* raw
+                       ,stamp_t*       time_stamp) { 
+    const stamp_t* words      = raw + 1;
+    stamp_t        slot_count = raw[0];
+    stamp_t        last_stamp = 0;
+    int            samples    = 0;
+
+    if(slot_count > 4*DEBUG_SAMPLE_DEPTH) 
+        slot_count = 4*DEBUG_SAMPLE_DEPTH;
+
+    for(stamp_t slot = 0; slot < slot_count; ) { 
+    stamp_t value = (words[slot/4] >> (16*(slot%4))) & 0xFFFF;
+        if(value & 0x8000) { 
+            //Escape, absolute stamp in this and the next three slots
+            if(slot + 4 > slot_count) break;
+            last_stamp = value & 0x7FFF;
+            for(int i = 1; i < 4; i++) 
+                last_stamp = (last_stamp << 16) | ((words[(slot+i)/4] >> (16*((slot+i)%4))) & 0xFFFF);
+            slot += 4;
         }
-        free(time_stamp_buffer);
+        else { 
+            last_stamp += value;
+            slot++;
+        }
+        time_stamp[1 + samples++] = last_stamp;
+    }
+    time_stamp[0] = samples;
+    return samples;
+}
+
+void start_histogram_debug(const cl_kernel*          kernel
+                          ,const cl_command_queue*   queue
+                          ,const cl_int              buffer_id) { 
+
+    control_buffer(kernel,queue,buffer_id,D_HISTOGRAM);
+}
+
+void read_histogram_all_buffers(const cl_context         context
+                               ,const cl_kernel*         kernel
+                               ,const cl_command_queue*  queue
+                               ,stamp_t**                histogram) { 
+
+    const cl_int mem_size = NUM_DEBUG_POINTS*(HISTOGRAM_BINS+2);
+
+    read_trace_buffers(context,kernel,queue,D_READ_HISTOGRAM,ALL_DEBUG_POINTS,mem_size);
+    *histogram = trace_host_buffer;
+}
+
+stamp_t histogram_percentile(const stamp_t* histogram
+                            ,const double   percentile) { 
+    const stamp_t count = histogram[0];
+    const stamp_t max   = histogram[HISTOGRAM_BINS+1];
+    stamp_t       seen  = 0;
+
+    if(count == 0) 
+        return 0;
+    for(int bin = 0; bin < HISTOGRAM_BINS; bin++) { 
+        seen += histogram[1+bin];
+        if(seen >= percentile*count/100.0) { 
+            //Upper bound of the bin, capped by the longest interval
+            stamp_t bound = bin == 0 ? 0 : (((stamp_t) 1) << bin) - 1;
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+void merge_histogram(stamp_t*       histogram
+                    ,const stamp_t* other) { 
+    for(int i = 0; i <= HISTOGRAM_BINS; i++) 
+        histogram[i] += other[i];
+    if(other[HISTOGRAM_BINS+1] > histogram[HISTOGRAM_BINS+1]) 
+        histogram[HISTOGRAM_BINS+1] = other[HISTOGRAM_BINS+1];
+}
+
+void print_histogram(const stamp_t* histogram) { 
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+    const stamp_t* point = histogram + j*(HISTOGRAM_BINS+2);
+        printf("HIST %2d : count %10lu : p50 %10lu : p99 %10lu : max %10lu\n", j
+              ,(unsigned long) point[0]
+              ,(unsigned long) histogram_percentile(point,50.0)
+              ,(unsigned long) histogram_percentile(point,99.0)
+              ,(unsigned long) point[HISTOGRAM_BINS+1]);
+        for(int bin = 0; bin < HISTOGRAM_BINS; bin++) { 
+            if(point[1+bin]) 
+                printf("HIST %2d : [%20lu, %20lu] : %10lu\n", j
+                      ,(unsigned long) (bin == 0 ? 0 : ((stamp_t) 1) << (bin-1))
+                      ,(unsigned long) (bin == 0 ? 0 : (((stamp_t) 1) << bin) - 1)
+                      ,(unsigned long) point[1+bin]);
+        }
+    }
+}
+
+int write_trace_file(const char*    file_name
+                    ,const stamp_t* time_stamp
+                    ,const cl_uint* payload
+                    ,const double   clock_mhz) { 
+    trace_file_header_s header;
+    struct timeval      wall;
+    FILE*               fp;
+
+    //The host axis of the calibration only holds for the clock it measured
+    const bool   calibrated = debug_clock.valid && ((clock_mhz <= 0.0) || (clock_mhz == debug_clock.clock_mhz));
+    const double trace_mhz  = clock_mhz > 0.0 ? clock_mhz : calibrated ? debug_clock.clock_mhz : 0.0;
+    if(!(trace_mhz > 0.0)) { 
+        printf("-ERROR- No kernel clock for trace file %s, pass clock_mhz or calibrate with init_debug\n", file_name);
+        return -1;
+    }
+
+    fp = fopen(file_name,"wb");
+    if(fp == NULL) { 
+        printf("-ERROR- Could not open trace file %s\n", file_name);
+        return -1;
     }
+
+    memset(&header,0,sizeof(header));
+    strncpy(header.magic,TRACE_FILE_MAGIC,sizeof(header.magic));
+    gettimeofday(&wall,NULL);
+    header.version     = TRACE_FILE_VERSION;
+    header.num_points  = NUM_DEBUG_POINTS;
+    header.clock_mhz   = trace_mhz;
+    header.wall_anchor = wall.tv_sec + wall.tv_usec*1e-6;
+    header.host_anchor = aocl_utils::getCurrentTimestamp();
+    header.host_at_cycle0 = calibrated ? debug_clock.host_at_cycle0 : 0.0;
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+        if(TRACE_COUNT(time_stamp[j*(DEBUG_TRACE_DEPTH+1)]) >= DEBUG_TRACE_DEPTH) 
+            header.overflow_mask |= ((uint64_t) 1) << j;
+    }
+    fwrite(&header,sizeof(header),1,fp);
+
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+    trace_point_header_s point;
+    const stamp_t*       samples = time_stamp + j*(DEBUG_TRACE_DEPTH+1);
+        point.point = j;
+        point.flags = (header.overflow_mask >> j) & 1 ? TRACE_POINT_FULL : 0;
+    const cl_uint*       values  = payload == NULL ? NULL : payload + j*(DEBUG_SAMPLE_DEPTH+1);
+        point.count = TRACE_COUNT(samples[0]) < DEBUG_TRACE_DEPTH ? TRACE_COUNT(samples[0]) : DEBUG_TRACE_DEPTH;
+        //Payloads line up with the stamps only when both reads hold the same samples, 
+        //a 0 header means the kernels were built without payloads
+        if((values != NULL) && (values[0] != 0) && (values[0] == point.count)) 
+            point.flags |= TRACE_POINT_PAYLOAD;
+        fwrite(&point,sizeof(point),1,fp);
+        fwrite(samples + 1,sizeof(stamp_t),point.count,fp);
+        if(point.flags & TRACE_POINT_PAYLOAD) 
+            fwrite(values + 1,sizeof(cl_uint),point.count,fp);
+    }
+
+    if(fclose(fp) != 0) { 
+        printf("-ERROR- Could not write trace file %s\n", file_name);
+        return -1;
+    }
+    return 0;
 }
 
 void print_debug(const stamp_t* time_stamp) { 
     int valid_samples[NUM_DEBUG_POINTS];
-    for(int i = 0; i <= DEBUG_SAMPLE_DEPTH; i++) { 
+    for(int i = 0; i <= DEBUG_TRACE_DEPTH; i++) { 
         printf("TIME %5d",i);
         for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
             if(i == 0) { 
-                valid_samples[j] = time_stamp[j*(DEBUG_SAMPLE_DEPTH+1)+i]; 
+                valid_samples[j] = TRACE_COUNT(time_stamp[j*(DEBUG_TRACE_DEPTH+1)+i]); 
             }
             else { 
                 if(valid_samples[j]) {
-                    printf(": %10ld :", time_stamp[j*(DEBUG_SAMPLE_DEPTH+1)+i]);
+                    printf(": %10ld :", time_stamp[j*(DEBUG_TRACE_DEPTH+1)+i]);
                     valid_samples[j]--;
                 }
                 else 
                     printf(": %s :", "----------");
             }
         }
-        if(i)printf("%4d ",(int) (time_stamp[1+DEBUG_SAMPLE_DEPTH+i] - time_stamp[i]));
         printf("\n");
     }
 }
 
+#if NUM_DEBUG_POINTS > 0
+/* Heap order of the merge, earlier next stamp first and the lower point on a tie */
+static inline bool trace_merge_before(const trace_merge_s* merge
+                                     ,const cl_uint        a
+                                     ,const cl_uint        b) { 
+    const stamp_t stamp_a = merge->samples[a][merge->cursor[a]];
+    const stamp_t stamp_b = merge->samples[b][merge->cursor[b]];
+    return (stamp_a < stamp_b) || ((stamp_a == stamp_b) && (a < b));
+}
+
+static void trace_merge_sift_down(trace_merge_s* merge
+                                 ,int            node) { 
+    for(;;) { 
+    int smallest = node;
+    int left     = 2*node + 1;
+    int right    = 2*node + 2;
+        if(left  < merge->heap_size && trace_merge_before(merge,merge->heap[left] ,merge->heap[smallest])) 
+            smallest = left;
+        if(right < merge->heap_size && trace_merge_before(merge,merge->heap[right],merge->heap[smallest])) 
+            smallest = right;
+        if(smallest == node) 
+            return;
+        cl_uint swap          = merge->heap[node];
+        merge->heap[node]     = merge->heap[smallest];
+        merge->heap[smallest] = swap;
+        node                  = smallest;
+    }
+}
+#endif 
+
+void trace_merge_init_points(trace_merge_s*  merge
+                            ,const stamp_t** samples
+                            ,const size_t*   count
+                            ,const cl_uint** payloads) { 
+    merge->heap_size = 0;
+#if NUM_DEBUG_POINTS > 0
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+        merge->samples[j]  = samples[j];
+        merge->payloads[j] = payloads ? payloads[j] : NULL;
+        merge->count[j]    = samples[j] ? count[j] : 0;
+        merge->cursor[j]   = 0;
+        if(merge->count[j] > 0) 
+            merge->heap[merge->heap_size++] = j;
+    }
+    for(int node = merge->heap_size/2 - 1; node >= 0; node--) 
+        trace_merge_sift_down(merge,node);
+#endif 
+}
+
+void trace_merge_init(trace_merge_s*  merge
+                     ,const stamp_t*  time_stamp
+                     ,const cl_uint*  payload) { 
+#if NUM_DEBUG_POINTS > 0
+    const stamp_t* samples  [NUM_DEBUG_POINTS];
+    const cl_uint* payloads [NUM_DEBUG_POINTS];
+    size_t         count    [NUM_DEBUG_POINTS];
+
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+    const stamp_t* buffer = time_stamp + j*(DEBUG_TRACE_DEPTH+1);
+        samples[j]  = buffer + 1;
+        count[j]    = TRACE_COUNT(buffer[0]) < DEBUG_TRACE_DEPTH ? TRACE_COUNT(buffer[0]) : DEBUG_TRACE_DEPTH;
+        //Payloads line up with the stamps only when both reads hold the same samples, 
+        //a 0 header means the kernels were built without payloads
+        payloads[j] = (payload != NULL) && (payload[j*(DEBUG_SAMPLE_DEPTH+1)] != 0) && 
+                      (payload[j*(DEBUG_SAMPLE_DEPTH+1)] == count[j]) ? 
+                      payload + j*(DEBUG_SAMPLE_DEPTH+1) + 1 : NULL;
+    }
+    trace_merge_init_points(merge,samples,count,payloads);
+#else 
+    merge->heap_size = 0;
+#endif 
+}
+
+bool trace_merge_next(trace_merge_s* merge
+                     ,trace_event_s* event) { 
+#if NUM_DEBUG_POINTS > 0
+    if(merge->heap_size == 0) 
+        return false;
+
+    const cl_uint point = merge->heap[0];
+    const size_t  index = merge->cursor[point];
+    event->stamp   = merge->samples[point][index];
+    event->point   = point;
+    event->payload = merge->payloads[point] ? merge->payloads[point][index] : 0;
+    event->index   = index;
+
+    //Advance the point at the top, or drop it once it has no samples left
+    merge->cursor[point]++;
+    if(merge->cursor[point] == merge->count[point]) 
+        merge->heap[0] = merge->heap[--merge->heap_size];
+    trace_merge_sift_down(merge,0);
+    return true;
+#else 
+    return false;
+#endif 
+}
+
+void print_debug_merged(const stamp_t* time_stamp
+                       ,const cl_uint* payload) { 
+    trace_merge_s merge;
+    trace_event_s event;
+    stamp_t       last       = 0;
+    stamp_t       last_point [NUM_DEBUG_POINTS];
+    bool          seen_point [NUM_DEBUG_POINTS];
+    size_t        events     = 0;
+
+    memset(seen_point,0,sizeof(seen_point));
+    trace_merge_init(&merge,time_stamp,payload);
+    printf("%8s %6s %20s %10s %10s %10s\n","EVENT","POINT","STAMP","DELTA","POINT_DELTA","PAYLOAD");
+    while(trace_merge_next(&merge,&event)) { 
+        printf("%8lu %6u %20lu %10lu %10lu %10u\n", (unsigned long) events, event.point, (unsigned long) event.stamp, 
+               (unsigned long) (events ? event.stamp - last : 0), 
+               (unsigned long) (seen_point[event.point] ? event.stamp - last_point[event.point] : 0), 
+               event.payload);
+        last                    = event.stamp;
+        last_point[event.point] = event.stamp;
+        seen_point[event.point] = true;
+        events++;
+    }
+}
+
+
+#if NUM_DEBUG_POINTS > 0
+/* Streaming state of a trace buffer, the consumer thread owns the queue, kernel and 
+ * slices while the stream is active */
+typedef struct { 
+    bool              active;
+    pthread_t         thread;
+    cl_uint           buffer_id;
+    cl_command_queue  queue;
+    cl_kernel         kernel;
+    cl_mem            slice      [DEBUG_STREAM_SLICES];
+    stamp_t*          staging    [DEBUG_STREAM_SLICES];
+    cl_event          slice_done [DEBUG_STREAM_SLICES];
+    stamp_t*          samples;
+    size_t            num_samples;
+    size_t            capacity;
+    cl_ulong          dropped;
+    int               tails;       //Last blocks received, the device sends DEBUG_STREAM_SLICES
+    bool              lost;        //A drain ran but could not be read back
+} debug_stream_s;
+
+static debug_stream_s debug_stream[NUM_DEBUG_POINTS];
+
+static const cl_int stream_slice_size = STREAM_SLICE_BLOCKS*(STREAM_BLOCK_DEPTH+1);
+
+/* Launch stream_stamp into slice and read it back without blocking */
+static cl_int enqueue_stream_slice(debug_stream_s* stream, int slice) { 
+    cl_int   status;
+    cl_event drain_done;
+    cl_uint  num_blocks = STREAM_SLICE_BLOCKS;
+
+    status  = clSetKernelArg(stream->kernel,0,sizeof(cl_mem) ,&stream->slice[slice]);
+    status |= clSetKernelArg(stream->kernel,1,sizeof(cl_uint),&num_blocks);
+    status |= clSetKernelArg(stream->kernel,2,sizeof(cl_uint),&stream->buffer_id);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not set arguments for  Kernel %s %d\n","stream_stamp", status);
+        return status;
+    }
+
+    status = clEnqueueTask(stream->queue,stream->kernel,0,NULL,&drain_done);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not Enqueue Kernel %s\n","stream_stamp");
+        return status;
+    }
+
+	status = clEnqueueReadBuffer(stream->queue,
+                                 stream->slice[slice],
+                                 CL_FALSE,
+                                 0,
+			                     sizeof(stamp_t) * stream_slice_size,
+                                 stream->staging[slice],
+                                 1,
+                                 &drain_done,
+                                 &stream->slice_done[slice]);
+    if(status != CL_SUCCESS) { 
+        //The drain still takes its blocks, wait for it with an empty slice
+        printf("-ERROR- Could not read stream slice from Kernel, its blocks are lost\n");
+        memset(stream->staging[slice],0,sizeof(stamp_t)*stream_slice_size);
+        stream->slice_done[slice] = drain_done;
+        stream->lost              = true;
+    }
+    else 
+        clReleaseEvent(drain_done);
+    clFlush(stream->queue);
+    return CL_SUCCESS;
+}
+
+/* Append the valid stamps of a slice to the host trace, returns true on the last block */
+static bool append_stream_slice(debug_stream_s* stream, const stamp_t* slice) { 
+    for(int block = 0; block < STREAM_SLICE_BLOCKS; block++) { 
+    const stamp_t* data   = slice + block*(STREAM_BLOCK_DEPTH+1);
+    stamp_t        header = data[0];
+    size_t         valid  = header & 0xFFFFFFFF;
+
+        stream->dropped += (header >> 32) & 0x7FFFFFFF;
+        if(stream->num_samples + valid > stream->capacity) { 
+            size_t capacity = stream->capacity ? 2*stream->capacity : 16*STREAM_BLOCK_DEPTH;
+            while(capacity < stream->num_samples + valid) capacity *= 2;
+            stamp_t* samples = (stamp_t *) realloc(stream->samples, sizeof(stamp_t)*capacity);
+            if(samples == NULL) { 
+                printf("-ERROR- Out of host memory for trace buffer %0d stream\n", stream->buffer_id);
+                stream->dropped += valid;
+                valid = 0;
+            }
+            else { 
+                stream->samples  = samples;
+                stream->capacity = capacity;
+            }
+        }
+        memcpy(stream->samples + stream->num_samples, data + 1, sizeof(stamp_t)*valid);
+        stream->num_samples += valid;
+        if((header >> 63) & 1) 
+            return true;
+    }
+    return false;
+}
+
+/* Consumer thread, keeps DEBUG_STREAM_SLICES drains in flight and appends them in order. 
+ * After the last block the device sends one empty last block for every other slice in flight. 
+ * Every launched drain is waited for, a drain that cannot be launched leaves fewer in flight 
+ * and stop_stream_debug reads the blocks they would have taken */
+static void* stream_consumer(void* arg) { 
+    debug_stream_s* stream    = (debug_stream_s *) arg;
+    int             in_flight = 0;
+    int             slice     = 0;
+
+    for(int i = 0; i < DEBUG_STREAM_SLICES; i++) { 
+        if(enqueue_stream_slice(stream,i) != CL_SUCCESS) 
+            break;
+        in_flight++;
+    }
+
+    //The stream queue is in order, slices complete in launch order
+    for(; in_flight > 0; in_flight--) { 
+        clWaitForEvents(1,&stream->slice_done[slice]);
+        clReleaseEvent(stream->slice_done[slice]);
+        if(append_stream_slice(stream,stream->staging[slice])) 
+            stream->tails++;
+        else if((stream->tails == 0) & (in_flight == DEBUG_STREAM_SLICES)) { 
+            if(enqueue_stream_slice(stream,slice) == CL_SUCCESS) 
+                in_flight++;
+        }
+        slice = (slice + 1) % DEBUG_STREAM_SLICES;
+    }
+    return NULL;
+}
+
+/* Read the blocks of a stopped stream the consumer did not take, one drain at a time, until 
+ * the device has handed over all its last blocks and is back in D_STOP */
+static void drain_stream_tail(debug_stream_s* stream) { 
+    while((stream->tails < DEBUG_STREAM_SLICES) & !stream->lost) { 
+        if(enqueue_stream_slice(stream,0) != CL_SUCCESS) { 
+            printf("-ERROR- Could not drain trace buffer %0d stream\n", stream->buffer_id);
+            return;
+        }
+        clWaitForEvents(1,&stream->slice_done[0]);
+        clReleaseEvent(stream->slice_done[0]);
+        if(append_stream_slice(stream,stream->staging[0])) 
+            stream->tails++;
+    }
+    if(stream->lost) 
+        printf("-WARN- Trace buffer %0d stream lost blocks, the buffer may not stop\n", stream->buffer_id);
+}
+
+/* Release the device and host resources of a stream, the samples stay with the caller */
+static void release_stream(debug_stream_s* stream) { 
+    for(int i = 0; i < DEBUG_STREAM_SLICES; i++) { 
+        if(stream->slice[i]) 
+            clReleaseMemObject(stream->slice[i]);
+        free(stream->staging[i]);
+        stream->slice[i]   = NULL;
+        stream->staging[i] = NULL;
+    }
+    if(stream->kernel) 
+        clReleaseKernel(stream->kernel);
+    if(stream->queue) 
+        clReleaseCommandQueue(stream->queue);
+    stream->kernel = NULL;
+    stream->queue  = NULL;
+}
+
+void start_stream_debug(const cl_context         context
+                       ,const cl_program         program
+                       ,const cl_device_id       device
+                       ,const cl_kernel*         kernel
+                       ,const cl_command_queue*  queue
+                       ,const cl_int             buffer_id) { 
+
+    cl_int          status;
+    debug_stream_s* stream = &debug_stream[buffer_id];
+
+    if(stream->active) { 
+        printf("-ERROR- Trace buffer %0d is already streaming\n", buffer_id);
+        return;
+    }
+    memset(stream,0,sizeof(debug_stream_s));
+    stream->buffer_id = buffer_id;
+
+    stream->queue = clCreateCommandQueue(context,device,0,&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create stream queue in debug %0d\n", buffer_id);
+        stream->queue = NULL;
+        return;
+    }
+    stream->kernel = clCreateKernel(program,"stream_stamp",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create kernel in debug %s\n", "stream_stamp");
+        stream->kernel = NULL;
+        release_stream(stream);
+        return;
+    }
+    for(int i = 0; i < DEBUG_STREAM_SLICES; i++) { 
+        stream->slice[i] = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t)*stream_slice_size, NULL, &status);
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not create stream slice in debug %0d\n", buffer_id);
+            stream->slice[i] = NULL;
+            release_stream(stream);
+            return;
+        }
+        if(posix_memalign ((void **) &stream->staging[i],64,sizeof(stamp_t)*stream_slice_size) != 0) { 
+            printf("-ERROR- Could not allocate stream staging in debug %0d\n", buffer_id);
+            stream->staging[i] = NULL;
+            release_stream(stream);
+            return;
+        }
+    }
+
+    control_buffer(kernel,queue,buffer_id,D_STOP);
+    control_buffer(kernel,queue,buffer_id,D_RECORD_STREAM);
+
+    if(pthread_create(&stream->thread,NULL,stream_consumer,stream) != 0) { 
+        printf("-ERROR- Could not start stream consumer for trace buffer %0d\n", buffer_id);
+        //The buffer already streams, stop it and take its last blocks here
+        control_buffer(kernel,queue,buffer_id,D_STOP);
+        drain_stream_tail(stream);
+        release_stream(stream);
+        free(stream->samples);
+        stream->samples = NULL;
+        return;
+    }
+    stream->active  = true;
+    streaming_mask |= 1u << buffer_id;
+}
+
+size_t stop_stream_debug(const cl_kernel*          kernel
+                        ,const cl_command_queue*   queue
+                        ,const cl_int              buffer_id
+                        ,stamp_t**                 time_stamp
+                        ,cl_ulong*                 dropped) { 
+
+    debug_stream_s* stream = &debug_stream[buffer_id];
+    size_t          num_samples;
+
+    if(!stream->active) { 
+        *time_stamp = NULL;
+        if(dropped) *dropped = 0;
+        return 0;
+    }
+
+    control_buffer(kernel,queue,buffer_id,D_STOP);
+    pthread_join(stream->thread,NULL);
+    drain_stream_tail(stream);
+    release_stream(stream);
+
+    *time_stamp = stream->samples;
+    if(dropped) *dropped = stream->dropped;
+    num_samples     = stream->num_samples;
+    stream->active  = false;
+    streaming_mask &= ~(1u << buffer_id);
+    return num_samples;
+}
+
+/* Launch read_stamp with D_READ_COUNTERS on the given kernel and queue and copy the counters of 
+ * every trace buffer from buffer into counters */
+static cl_int read_live_counters_on(const cl_kernel        kernel
+                                   ,const cl_command_queue queue
+                                   ,const cl_mem           buffer
+                                   ,stamp_t*               counters) { 
+    cl_int   status;
+    cl_int   cmd_in    = (cl_int) D_READ_COUNTERS;
+    cl_uint  all       = ALL_DEBUG_POINTS;
+    cl_uint  no_mask   = 0;
+    cl_event read_done;
+
+    status  = clSetKernelArg(kernel,0,sizeof(cl_int) ,&cmd_in);
+    status |= clSetKernelArg(kernel,1,sizeof(cl_mem) ,&buffer);
+    status |= clSetKernelArg(kernel,2,sizeof(cl_uint),&all);
+    status |= clSetKernelArg(kernel,3,sizeof(cl_uint),&no_mask);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not set arguments for  Kernel %s %d\n","read_stamp", status);
+        return status;
+    }
+    status = clEnqueueTask(queue,kernel,0,NULL,&read_done);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not Enqueue Kernel %s\n","read_stamp");
+        return status;
+    }
+    status = clEnqueueReadBuffer(queue,buffer,CL_TRUE,0,sizeof(stamp_t)*NUM_DEBUG_POINTS*LIVE_COUNTER_WORDS,
+                                 counters,1,&read_done,NULL);
+    clReleaseEvent(read_done);
+    if(status != CL_SUCCESS) 
+        printf("-ERROR- Could not read live counters\n");
+    return status;
+}
+
+static cl_mem  live_read_buffer = NULL;
+static stamp_t live_host_buffer[NUM_DEBUG_POINTS*LIVE_COUNTER_WORDS];
+
+void read_live_counters(const cl_context         context
+                       ,const cl_kernel*         kernel
+                       ,const cl_command_queue*  queue
+                       ,stamp_t**                counters) { 
+    cl_int status;
+
+    if(live_read_buffer == NULL) { 
+        live_read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(live_host_buffer), NULL, &status);
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not create live counter read buffer\n");
+            live_read_buffer = NULL;
+            *counters = NULL;
+            return;
+        }
+    }
+    read_live_counters_on(kernel[0],queue[0],live_read_buffer,live_host_buffer);
+    *counters = live_host_buffer;
+}
+
+void reset_live_counters(const cl_kernel*        kernel
+                        ,const cl_command_queue* queue) { 
+
+    cl_event done = control_buffers_async(kernel,queue,DEBUG_POINTS_MASK,D_RESET_COUNTERS,0,NULL);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
+    }
+}
+
+void print_live_counters(const stamp_t* counters
+                        ,const stamp_t* previous
+                        ,const double   seconds
+                        ,FILE*          out) { 
+    fprintf(out,"%6s %14s %12s %10s %10s %12s %10s\n","POINT","SNAPSHOTS","RATE/s","MIN","MAX","MEAN","LOST");
+    for(int j = 0; j < NUM_DEBUG_POINTS; j++) { 
+    const stamp_t* live  = counters + j*LIVE_COUNTER_WORDS;
+    const stamp_t  count = live[0] - (previous ? previous[j*LIVE_COUNTER_WORDS] : 0);
+        fprintf(out,"%6d %14lu %12.1f %10lu %10lu %12.1f %10lu\n", j, (unsigned long) live[0], 
+                seconds > 0.0 ? count/seconds : 0.0, 
+                (unsigned long) (live[0] > 1 ? live[1] : 0), (unsigned long) live[2], 
+                live[0] > 1 ? (double) live[3]/(live[0] - 1) : 0.0, (unsigned long) live[4]);
+    }
+}
+
+/* Background poller of the live counters, it owns its queue, read_stamp kernel and buffer */
+typedef struct { 
+    bool              active;
+    bool              stop;
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    wake;
+    cl_command_queue  queue;
+    cl_kernel         kernel;
+    cl_mem            buffer;
+    unsigned          period_ms;
+    FILE*             out;
+} live_monitor_s;
+
+static live_monitor_s live_monitor = { false };
+
+static void* live_monitor_thread(void* arg) { 
+    live_monitor_s* monitor = (live_monitor_s *) arg;
+    stamp_t         counters [NUM_DEBUG_POINTS*LIVE_COUNTER_WORDS];
+    stamp_t         previous [NUM_DEBUG_POINTS*LIVE_COUNTER_WORDS];
+    double          last     = aocl_utils::getCurrentTimestamp();
+    bool            have_previous = false;
+
+    pthread_mutex_lock(&monitor->lock);
+    while(!monitor->stop) { 
+    struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME,&deadline);
+        deadline.tv_sec  += monitor->period_ms/1000;
+        deadline.tv_nsec += (monitor->period_ms%1000)*1000000L;
+        if(deadline.tv_nsec >= 1000000000L) { 
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&monitor->wake,&monitor->lock,&deadline);
+        if(monitor->stop) 
+            break;
+        pthread_mutex_unlock(&monitor->lock);
+
+        if(read_live_counters_on(monitor->kernel,monitor->queue,monitor->buffer,counters) == CL_SUCCESS) { 
+        double now = aocl_utils::getCurrentTimestamp();
+            fprintf(monitor->out,"-INFO- Live counters at %.3f s\n", now);
+            print_live_counters(counters,have_previous ? previous : NULL,now - last,monitor->out);
+            fflush(monitor->out);
+            memcpy(previous,counters,sizeof(counters));
+            have_previous = true;
+            last          = now;
+        }
+        pthread_mutex_lock(&monitor->lock);
+    }
+    pthread_mutex_unlock(&monitor->lock);
+    return NULL;
+}
+
+void start_live_monitor(const cl_context         context
+                       ,const cl_program         program
+                       ,const cl_device_id       device
+                       ,const unsigned           period_ms
+                       ,FILE*                    out) { 
+    cl_int status;
+
+    if(live_monitor.active) { 
+        printf("-ERROR- Live counter monitor is already running\n");
+        return;
+    }
+    live_monitor.stop      = false;
+    live_monitor.period_ms = period_ms;
+    live_monitor.out       = out;
+    live_monitor.queue = clCreateCommandQueue(context,device,0,&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create queue in debug %s\n", "live monitor");
+        return;
+    }
+    live_monitor.kernel = clCreateKernel(program,"read_stamp",&status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create kernel in debug %s\n", "read_stamp");
+        clReleaseCommandQueue(live_monitor.queue);
+        return;
+    }
+    live_monitor.buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(stamp_t)*NUM_DEBUG_POINTS*LIVE_COUNTER_WORDS, NULL, &status);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not create live counter read buffer\n");
+        clReleaseKernel(live_monitor.kernel);
+        clReleaseCommandQueue(live_monitor.queue);
+        return;
+    }
+    pthread_mutex_init(&live_monitor.lock,NULL);
+    pthread_cond_init(&live_monitor.wake,NULL);
+    if(pthread_create(&live_monitor.thread,NULL,live_monitor_thread,&live_monitor) != 0) { 
+        printf("-ERROR- Could not start the live counter monitor\n");
+        return;
+    }
+    live_monitor.active = true;
+}
+
+void stop_live_monitor() { 
+    if(!live_monitor.active) 
+        return;
+    pthread_mutex_lock(&live_monitor.lock);
+    live_monitor.stop = true;
+    pthread_cond_signal(&live_monitor.wake);
+    pthread_mutex_unlock(&live_monitor.lock);
+    pthread_join(live_monitor.thread,NULL);
+
+    clReleaseMemObject(live_monitor.buffer);
+    clReleaseKernel(live_monitor.kernel);
+    clReleaseCommandQueue(live_monitor.queue);
+    pthread_cond_destroy(&live_monitor.wake);
+    pthread_mutex_destroy(&live_monitor.lock);
+    live_monitor.active = false;
+}
+#endif //NUM_DEBUG_POINTS
 
 void read_watch(const cl_context         context
                ,const cl_kernel*         kernel
@@ -286,16 +1367,20 @@ void read_watch(const cl_context         context
                ,const cl_int             watch_id
                ,watch_s**                watch_point) {
 
-    cl_mem read_buffer;
     cl_int status;
 
-    const cl_int mem_size = WATCH_SAMPLE_DEPTH+2;
+    const cl_int mem_size = WATCH_READ_DEPTH;
 
     posix_memalign ((void **) watch_point,64,sizeof(watch_s)*mem_size);
 
-    read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(watch_s)*mem_size, NULL, &status);
-    if(status != CL_SUCCESS) { 
-        printf("-ERROR- Could not create read buffer in rest_debug\n");
+    if(watch_read_buffer == NULL) { 
+        watch_read_buffer = clCreateBuffer(context,CL_MEM_WRITE_ONLY,sizeof(watch_s)*mem_size, NULL, &status);
+        if(status != CL_SUCCESS) { 
+            printf("-ERROR- Could not create watch read buffer\n");
+            watch_read_buffer = NULL;
+            memset(*watch_point,0,sizeof(watch_s)*mem_size);
+            return;
+        }
     }
     
     cl_int cmd_in = D_READ;
@@ -305,12 +1390,14 @@ void read_watch(const cl_context         context
         printf("-ERROR- Could not set argument[0] for  Kernel %s %d\n","read_watch", status);
     }
 
-    status = clSetKernelArg(kernel[1],1,sizeof(cl_mem) ,&read_buffer);
+    status = clSetKernelArg(kernel[1],1,sizeof(cl_mem) ,&watch_read_buffer);
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not set argument[1] for  Kernel %s %d\n","read_watch", status);
     }
 
     clSetKernelArg(kernel[1],2,sizeof(cl_int),&watch_id);
+    cl_uint no_mask = 0;
+    clSetKernelArg(kernel[1],3,sizeof(cl_uint),&no_mask);
 
     status = clEnqueueTask(queue[1],kernel[1],0,NULL,NULL);
     if(status != CL_SUCCESS) { 
@@ -321,7 +1408,7 @@ void read_watch(const cl_context         context
 
 
 	status = clEnqueueReadBuffer(queue[1],
-                                 read_buffer,
+                                 watch_read_buffer,
                                  CL_TRUE,
                                  0,
 			                     sizeof(watch_s) * mem_size,
@@ -341,7 +1428,7 @@ void read_watch_all_buffers(const cl_context         context
                            ,const cl_command_queue*  queue
                            ,watch_s**                watch_point) {
 
-    const cl_int mem_size = NUM_WATCH_POINTS*(WATCH_SAMPLE_DEPTH+2);
+    const cl_int mem_size = NUM_WATCH_POINTS*WATCH_READ_DEPTH;
 
     posix_memalign ((void **) watch_point,64,sizeof(watch_s)*mem_size);
 
@@ -350,9 +1437,11 @@ void read_watch_all_buffers(const cl_context         context
 
         printf("-INFO- Reading WatchBUffer[%0d]\n", watch_id);
         read_watch( context ,kernel ,queue ,watch_id ,&watch_buffer);
-        for(int sample_id = 0; sample_id <= WATCH_SAMPLE_DEPTH+1; sample_id++) { 
-            (*watch_point)[watch_id*(WATCH_SAMPLE_DEPTH+2) + sample_id] = watch_buffer[sample_id];
-            printf("watch[%0d]  = %0d\n", watch_id , watch_buffer[sample_id].addr);
+        memcpy(*watch_point + watch_id*WATCH_READ_DEPTH,watch_buffer,sizeof(watch_s)*WATCH_READ_DEPTH);
+        //Only the recorded samples, the region counters are printed by print_watch_regions
+        int valid = watch_buffer[1].tag < WATCH_SAMPLE_DEPTH ? watch_buffer[1].tag : WATCH_SAMPLE_DEPTH;
+        for(int sample_id = 0; sample_id < valid; sample_id++) { 
+            printf("watch[%0d]  = %0d\n", watch_id , watch_buffer[2+sample_id].addr);
         }
         free(watch_buffer);
     }
@@ -362,46 +1451,92 @@ void print_watch(const watch_s* watch_point) {
     for(int i = 0; i <= WATCH_SAMPLE_DEPTH+1; i++) { 
         printf("WATCH %5d",i);
         for(int j = 0; j < NUM_WATCH_POINTS; j++) { 
-            if(i>1) printf(": (%8d : %4d) ", watch_point[j*(WATCH_SAMPLE_DEPTH+2)+i].addr , watch_point[j*(WATCH_SAMPLE_DEPTH+2)+i].tag );
+            if(i>1) printf(": (%8d : %4d) ", watch_point[j*WATCH_READ_DEPTH+i].addr , watch_point[j*WATCH_READ_DEPTH+i].tag );
             else if (i==1)
-                printf(": (Valid : %0d) ", watch_point[j*(WATCH_SAMPLE_DEPTH+2)+i].tag );
+                printf(": (Valid : %0d) ", watch_point[j*WATCH_READ_DEPTH+i].tag );
 
-            else  printf(": 0x%8X :", watch_point[j*(WATCH_SAMPLE_DEPTH+2)+i].addr);
+            else  printf(": 0x%8X :", watch_point[j*WATCH_READ_DEPTH+i].addr);
         }
         printf("\n");
     }
+    print_watch_regions(watch_point);
+}
+
+/* Regions per row of the heat map */
+#define WATCH_REGIONS_PER_ROW 8
+
+void print_watch_regions(const watch_s* watch_point) { 
+    for(int j = 0; j < NUM_WATCH_POINTS; j++) { 
+    const watch_s* hits  = watch_point + j*WATCH_READ_DEPTH + WATCH_SAMPLE_DEPTH + 2;
+    bool           title = false;
+        for(int row = 0; row < WATCH_REGIONS; row += WATCH_REGIONS_PER_ROW) { 
+        bool hit = false;
+            for(int region = row; (region < row + WATCH_REGIONS_PER_ROW) & (region < WATCH_REGIONS); region++) 
+                hit |= hits[region].addr != 0;
+            if(!hit) 
+                continue;
+            if(!title) 
+                printf("REGIONS of watch %0d\n", j);
+            title = true;
+            printf("%5d :",row);
+            for(int region = row; (region < row + WATCH_REGIONS_PER_ROW) & (region < WATCH_REGIONS); region++) 
+                printf(" %10u", (unsigned) hits[region].addr);
+            printf("\n");
+        }
+    }
 }
 
 
 void reset_watch_all(const cl_kernel*        kernel
                     ,const cl_command_queue* queue) {
 
-    for(int watch_id = 0; watch_id <  NUM_WATCH_POINTS ; watch_id++) { 
-        reset_watch(kernel,queue,watch_id);
+    cl_event done = control_watches_async(kernel,queue,WATCH_POINTS_MASK,D_RESET,0,NULL);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
     }
 }
 
-void control_watch(const cl_kernel*        kernel
-                  ,const cl_command_queue* queue
-                  ,const cl_int            watch_id
-                  ,const debug_command_e   cmd) {
+cl_event control_watches_async(const cl_kernel*        kernel
+                              ,const cl_command_queue* queue
+                              ,const cl_uint           watch_mask
+                              ,const debug_command_e   cmd
+                              ,const cl_uint           num_events_in_wait_list
+                              ,const cl_event*         event_wait_list) {
 
-    cl_int status;
-    cl_int cmd_in = (cl_int) cmd;
+    cl_int   status;
+    cl_event done     = NULL;
+    cl_int   cmd_in   = (cl_int) cmd;
+    cl_uint  no_watch = NUM_WATCH_POINTS;  //Watch points are addressed only through the mask
 
     status  = clSetKernelArg(kernel[1],0,sizeof(cl_int),&cmd_in);
     status |= clSetKernelArg(kernel[1],1,sizeof(cl_mem),NULL);
-    status |= clSetKernelArg(kernel[1],2,sizeof(cl_int),&watch_id); 
+    status |= clSetKernelArg(kernel[1],2,sizeof(cl_uint),&no_watch); 
+    status |= clSetKernelArg(kernel[1],3,sizeof(cl_uint),&watch_mask); 
 
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not set the kernel arguments");
     }
 
-    status = clEnqueueTask(queue[1],kernel[1],0,NULL,NULL);
+    status = clEnqueueTask(queue[1],kernel[1],num_events_in_wait_list,event_wait_list,&done);
     if(status != CL_SUCCESS) { 
         printf("-ERROR- Could not Enqueue Kernel");
+        return NULL;
+    }
+    clFlush(queue[1]);
+    return done;
+}
+
+void control_watch(const cl_kernel*        kernel
+                  ,const cl_command_queue* queue
+                  ,const cl_int            watch_id
+                  ,const debug_command_e   cmd) {
+
+    cl_event done = control_watches_async(kernel,queue,1u << watch_id,cmd,0,NULL);
+    if(done != NULL) { 
+        clWaitForEvents(1,&done);
+        clReleaseEvent(done);
     }
-    clFinish(queue[1]);
 }
 
 
@@ -437,4 +1572,66 @@ void start_cyclic_watch(const cl_kernel*          kernel
 
 
 
+#if NUM_CHANNEL_STATS > 0
+/* Launch read_channel_stats with cmd, for D_READ copy the counters into stats_host_buffer */
+static void launch_channel_stats(const debug_command_e cmd) { 
+    cl_int   status;
+    cl_int   cmd_in = (cl_int) cmd;
+
+    status  = clSetKernelArg(stats_kernel,0,sizeof(cl_int),&cmd_in);
+    status |= clSetKernelArg(stats_kernel,1,sizeof(cl_mem),&stats_read_buffer);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not set arguments for  Kernel %s %d\n","read_channel_stats", status);
+        return;
+    }
+    status = clEnqueueTask(stats_queue,stats_kernel,0,NULL,NULL);
+    if(status != CL_SUCCESS) { 
+        printf("-ERROR- Could not Enqueue Kernel %s\n","read_channel_stats");
+        return;
+    }
+    if(cmd == D_READ) { 
+        status = clEnqueueReadBuffer(stats_queue,stats_read_buffer,CL_TRUE,0,sizeof(stats_host_buffer),stats_host_buffer,0,NULL,NULL);
+        if(status != CL_SUCCESS) 
+            printf("-ERROR- Could not read buffer from Kernel %s\n","read_channel_stats");
+    }
+    else 
+        clFinish(stats_queue);
+}
+#endif 
+
+void reset_channel_stats() { 
+#if NUM_CHANNEL_STATS > 0
+    launch_channel_stats(D_RESET);
+#endif 
+}
+
+void read_channel_stats(stamp_t** stats) { 
+#if NUM_CHANNEL_STATS > 0
+    launch_channel_stats(D_READ);
+    *stats = stats_host_buffer;
+#else 
+    *stats = NULL;
+#endif 
+}
+
+void print_channel_stats(const stamp_t* stats
+                        ,const char**   names) { 
+    if(stats == NULL) 
+        return;
+    printf("%-24s %14s %14s %10s %7s\n","CHANNEL","TRANSFERS","BLOCKED","LONGEST","UTIL%");
+    for(int i = 0; i < NUM_CHANNEL_STATS; i++) { 
+    const stamp_t* stat   = stats + i*CHANNEL_STAT_WORDS;
+    const stamp_t  cycles = stat[0] + stat[1];
+    char           name[24];
+        if((names != NULL) && (names[i] != NULL)) 
+            snprintf(name,sizeof(name),"%s",names[i]);
+        else 
+            snprintf(name,sizeof(name),"channel %d",i);
+        //A transfer takes a cycle, every other cycle spent in the call was blocked
+        printf("%-24s %14lu %14lu %10lu %7.2f\n", name, (unsigned long) stat[0], (unsigned long) stat[1], 
+               (unsigned long) stat[2], cycles ? 100.0*stat[0]/cycles : 0.0);
+    }
+}
+
+
 #endif //DEBUG_CPP
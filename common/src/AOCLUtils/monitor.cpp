@@ -3,51 +3,920 @@
 #include <CL/opencl.h>
 #include <aocl_mmd.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <math.h>
 #include "AOCLUtils/opencl.h"
 #include "AOCLUtils/monitor.h"
 
 extern int aclnalla_pcie0_handle;
 const char *boardname = "aclnalla_pcie0";
 
+/* Board table kept by libhook, see libhook/hook.c */
+extern "C" int hook_num_boards();
+extern "C" int hook_board(int i, const char **name);
+
+/**
+  * Moves an absolute deadline one sampling period ahead.
+  */
+static void monitor_advance(struct timespec *tick) {
+	tick->tv_sec  += MONITOR_PERIOD_MS / 1000;
+	tick->tv_nsec += (MONITOR_PERIOD_MS % 1000) * 1000000L;
+	if (tick->tv_nsec >= 1000000000L) {
+		tick->tv_sec++;
+		tick->tv_nsec -= 1000000000L;
+	}
+}
+
+/**
+  * Phase names, interned so that a sample only carries the index. Index 0 is no phase.
+  */
+static const char *monitor_phases[MONITOR_MAX_PHASES] = {""};
+static int monitor_num_phases = 1;
+static int monitor_phase = 0;
+static pthread_mutex_t monitor_phase_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void set_monitor_phase(const char *name) {
+	int phase = 0;
+	if (name != NULL) {
+		pthread_mutex_lock(&monitor_phase_lock);
+		for (phase = 1; phase < monitor_num_phases && strcmp(monitor_phases[phase], name) != 0; phase++)
+			;
+		if (phase == monitor_num_phases) {
+			if (phase < MONITOR_MAX_PHASES) {
+				monitor_phases[phase] = strdup(name);
+				__atomic_store_n(&monitor_num_phases, phase + 1, __ATOMIC_RELEASE);
+			} else {
+				printf("-WARN- More than %d monitor phases, %s is not tagged\n", MONITOR_MAX_PHASES, name);
+				phase = 0;
+			}
+		}
+		pthread_mutex_unlock(&monitor_phase_lock);
+	}
+	__atomic_store_n(&monitor_phase, phase, __ATOMIC_RELEASE);
+}
+
+static const char *monitor_phase_name(int phase) {
+	return phase > 0 && phase < __atomic_load_n(&monitor_num_phases, __ATOMIC_ACQUIRE) ? monitor_phases[phase] : "";
+}
+
 /**
-  * The function displays the temperature and power values of the FPGA board 
+  * Live source. Boards opened by the runtime, without the libhook table only aclnalla_pcie0 
+  * is known.
+  */
+static int mmd_num_boards(void *state) {
+	const int boards = hook_num_boards();
+	return boards > 0 ? boards : 1;
+}
+
+static const char *mmd_board_name(void *state, int board) {
+	const char *name = boardname;
+	if (hook_board(board, &name) < 0)
+		return boardname;
+	return name;
+}
+
+/**
+  * The function reads the temperature and power values of an FPGA board 
   * using two API functions. The two function definitions can be found in the
   * Intel FPGA SDK for OpenCL Custom Platform Toolkit User Guide.
   */
-int print_monitor(FILE *f) {
-	float temp, power;
+static int mmd_read(void *state, int board, monitor_sample_s *sample) {
 	size_t retsize;
-	double ts = aocl_utils::getCurrentTimestamp();
-	aocl_mmd_get_info(aclnalla_pcie0_handle, AOCL_MMD_TEMPERATURE, sizeof(float), (void *)&temp, &retsize);
-	aocl_mmd_card_info(boardname, AOCL_MMD_POWER, sizeof(float), (void *)&power, &retsize);
-	return fprintf(f, "[%f] temp=%f, power=%f\n", ts, temp, power);
+	const char *name = boardname;
+	int handle;
+	if (hook_num_boards() > 0) {
+		handle = hook_board(board, &name);
+	} else {
+		handle = board == 0 ? aclnalla_pcie0_handle : -1;
+	}
+	//Closed or unknown board, nothing to query
+	if (handle < 0)
+		return -1;
+	aocl_mmd_get_info(handle, AOCL_MMD_TEMPERATURE, sizeof(float), (void *)&sample->temperature, &retsize);
+	aocl_mmd_card_info(name, AOCL_MMD_POWER, sizeof(float), (void *)&sample->power, &retsize);
+	return 0;
+}
+
+static const monitor_source_s mmd_source = {"mmd", mmd_num_boards, mmd_board_name, mmd_read, NULL};
+
+/**
+  * Replay source, plays back a log written by start_monitor_record. The log time advances speed 
+  * times faster than the host clock from the first read, each board reads its last logged sample.
+  */
+struct monitor_replay_state {
+	monitor_log_record_s *records;
+	size_t num_records;
+	int    num_boards;
+	char   (*names)[MONITOR_LOG_NAME_LEN];
+	double speed;
+	bool   started;          //The first read happened at start
+	double start;
+};
+
+static struct monitor_replay_state monitor_replay;
+
+static int replay_num_boards(void *state) {
+	return ((const struct monitor_replay_state *) state)->num_boards;
+}
+
+static const char *replay_board_name(void *state, int board) {
+	const struct monitor_replay_state *replay = (const struct monitor_replay_state *) state;
+	return board >= 0 && board < replay->num_boards ? replay->names[board] : "replay";
+}
+
+static int replay_read(void *state, int board, monitor_sample_s *sample) {
+	struct monitor_replay_state *replay = (struct monitor_replay_state *) state;
+	const double now = aocl_utils::getCurrentTimestamp();
+	if (!replay->started) {
+		replay->started = true;
+		replay->start   = now;
+	}
+	const double t = replay->records[0].timestamp + (now - replay->start) * replay->speed;
+
+	//Last record at or before t, then back to the last one of the board
+	size_t lo = 0, hi = replay->num_records;
+	while (hi - lo > 1) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (replay->records[mid].timestamp <= t)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	for (size_t i = lo + 1; i-- > 0;) {
+		if (replay->records[i].board == board) {
+			sample->temperature = replay->records[i].temperature;
+			sample->power       = replay->records[i].power;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static const monitor_source_s replay_source = {"replay", replay_num_boards, replay_board_name, replay_read, &monitor_replay};
+
+/**
+  * Synthetic source, a first-order thermal model driven by a square wave load. Temperature 
+  * relaxes towards ambient + resistance * power with the time constant, in model time that 
+  * runs speed times faster than the host clock.
+  */
+struct monitor_model_state {
+	monitor_model_s model;
+	double speed;
+	bool   started;                         //The first read happened at start
+	double start;
+	double last[MONITOR_MAX_BOARDS];        //Model time of the last read per board
+	double temperature[MONITOR_MAX_BOARDS];
+};
+
+static struct monitor_model_state monitor_model;
+
+static int model_num_boards(void *state) {
+	return ((const struct monitor_model_state *) state)->model.boards;
+}
+
+static const char *model_board_name(void *state, int board) {
+	return "model";
+}
+
+static int model_read(void *state, int board, monitor_sample_s *sample) {
+	struct monitor_model_state *model = (struct monitor_model_state *) state;
+	const monitor_model_s *m = &model->model;
+	const double now = aocl_utils::getCurrentTimestamp();
+	if (board < 0 || board >= m->boards)
+		return -1;
+	if (!model->started) {
+		model->started = true;
+		model->start   = now;
+	}
+	const double t      = (now - model->start) * model->speed;
+	const double phase  = m->period_s > 0.0 ? fmod(t, m->period_s) / m->period_s : 0.0;
+	const double power  = m->idle_w + (phase < m->duty ? m->active_w : 0.0);
+	const double target = m->ambient_c + m->resistance_c_per_w * power;
+	const double dt     = t - model->last[board];
+	model->temperature[board] = target + (model->temperature[board] - target) * 
+	                            (m->time_constant_s > 0.0 ? exp(-dt / m->time_constant_s) : 0.0);
+	model->last[board] = t;
+	sample->temperature = (float) model->temperature[board];
+	sample->power       = (float) power;
+	return 0;
+}
+
+static const monitor_source_s model_source = {"model", model_num_boards, model_board_name, model_read, &monitor_model};
+
+/**
+  * Current source and the optional log every read sample is appended to. MONITOR_REPLAY selects a 
+  * log to replay or "model", MONITOR_REPLAY_SPEED its speed and MONITOR_RECORD a log to record, 
+  * so an unchanged application runs its monitoring without a board.
+  */
+static const monitor_source_s *monitor_source = NULL;
+static FILE *monitor_record = NULL;
+static pthread_mutex_t monitor_record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const monitor_source_s *current_monitor_source() {
+	if (monitor_source == NULL) {
+		monitor_source = &mmd_source;
+		const char *replay = getenv("MONITOR_REPLAY");
+		const char *speed  = getenv("MONITOR_REPLAY_SPEED");
+		const char *record = getenv("MONITOR_RECORD");
+		if (replay && strcmp(replay, "model") == 0) {
+			monitor_model_s model = MONITOR_MODEL_DEFAULT;
+			use_monitor_model(&model, speed ? atof(speed) : 1.0);
+		} else if (replay) {
+			use_monitor_replay(replay, speed ? atof(speed) : 1.0);
+		}
+		if (record)
+			start_monitor_record(record);
+	}
+	return monitor_source;
+}
+
+void use_monitor_source(const monitor_source_s *source) {
+	monitor_source = source ? source : &mmd_source;
+}
+
+int use_monitor_replay(const char *path, double speed) {
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		printf("-ERROR- Could not open monitor log %s\n", path);
+		return -1;
+	}
+	monitor_log_header_s header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, MONITOR_LOG_MAGIC, sizeof(header.magic)) != 0 || 
+	    header.version != MONITOR_LOG_VERSION || header.num_boards == 0) {
+		printf("-ERROR- %s is not a monitor log\n", path);
+		fclose(f);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	const long end = ftell(f);
+	const long first = sizeof(header) + header.num_boards * MONITOR_LOG_NAME_LEN;
+	const size_t num_records = end > first ? (end - first) / sizeof(monitor_log_record_s) : 0;
+	if (num_records == 0) {
+		printf("-ERROR- Monitor log %s holds no samples\n", path);
+		fclose(f);
+		return -1;
+	}
+	char (*names)[MONITOR_LOG_NAME_LEN] = (char (*)[MONITOR_LOG_NAME_LEN]) malloc(header.num_boards * MONITOR_LOG_NAME_LEN);
+	monitor_log_record_s *records = (monitor_log_record_s *) malloc(num_records * sizeof(monitor_log_record_s));
+	fseek(f, sizeof(header), SEEK_SET);
+	if (names == NULL || records == NULL || fread(names, MONITOR_LOG_NAME_LEN, header.num_boards, f) != header.num_boards || 
+	    fread(records, sizeof(monitor_log_record_s), num_records, f) != num_records) {
+		printf("-ERROR- Could not read monitor log %s\n", path);
+		free(names);
+		free(records);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	for (unsigned i = 0; i < header.num_boards; i++)
+		names[i][MONITOR_LOG_NAME_LEN - 1] = '\0';
+
+	free(monitor_replay.records);
+	free(monitor_replay.names);
+	monitor_replay.records     = records;
+	monitor_replay.num_records = num_records;
+	monitor_replay.names       = names;
+	monitor_replay.num_boards  = header.num_boards;
+	monitor_replay.speed       = speed > 0.0 ? speed : 1.0;
+	monitor_replay.started     = false;
+	monitor_source = &replay_source;
+	printf("-INFO- Replaying %lu monitor samples of %u boards from %s at %gx\n", (unsigned long) num_records, 
+	       header.num_boards, path, monitor_replay.speed);
+	return 0;
+}
+
+int use_monitor_model(const monitor_model_s *model, double speed) {
+	if (model->boards < 1 || model->boards > MONITOR_MAX_BOARDS) {
+		printf("-ERROR- Monitor model needs 1 to %d boards\n", MONITOR_MAX_BOARDS);
+		return -1;
+	}
+	monitor_model.model = *model;
+	monitor_model.speed   = speed > 0.0 ? speed : 1.0;
+	monitor_model.started = false;
+	for (int i = 0; i < MONITOR_MAX_BOARDS; i++) {
+		monitor_model.last[i]        = 0.0;
+		monitor_model.temperature[i] = model->ambient_c;
+	}
+	monitor_source = &model_source;
+	return 0;
+}
+
+void use_monitor_live() {
+	monitor_source = &mmd_source;
+}
+
+int start_monitor_record(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		printf("-ERROR- Could not create monitor log %s\n", path);
+		return -1;
+	}
+	const monitor_source_s *source = current_monitor_source();
+	monitor_log_header_s header;
+	memcpy(header.magic, MONITOR_LOG_MAGIC, sizeof(header.magic));
+	header.version    = MONITOR_LOG_VERSION;
+	header.num_boards = source->num_boards(source->state);
+	fwrite(&header, sizeof(header), 1, f);
+	for (unsigned i = 0; i < header.num_boards; i++) {
+		char name[MONITOR_LOG_NAME_LEN] = {0};
+		strncpy(name, source->board_name(source->state, i), MONITOR_LOG_NAME_LEN - 1);
+		fwrite(name, MONITOR_LOG_NAME_LEN, 1, f);
+	}
+	pthread_mutex_lock(&monitor_record_lock);
+	if (monitor_record)
+		fclose(monitor_record);
+	monitor_record = f;
+	pthread_mutex_unlock(&monitor_record_lock);
+	return 0;
+}
+
+void stop_monitor_record() {
+	pthread_mutex_lock(&monitor_record_lock);
+	if (monitor_record)
+		fclose(monitor_record);
+	monitor_record = NULL;
+	pthread_mutex_unlock(&monitor_record_lock);
+}
+
+int monitor_num_boards() {
+	const monitor_source_s *source = current_monitor_source();
+	return source->num_boards(source->state);
+}
+
+const char *monitor_board_name(int board) {
+	const monitor_source_s *source = current_monitor_source();
+	return source->board_name(source->state, board);
+}
+
+/**
+  * Sources keep state across reads, so reads are serialised. While the background sampler runs it 
+  * is the only reader of the source, everyone else gets the last sample it read of the board.
+  */
+static pthread_mutex_t monitor_source_lock = PTHREAD_MUTEX_INITIALIZER;
+static monitor_sample_s monitor_last[MONITOR_MAX_BOARDS];
+static bool monitor_last_valid[MONITOR_MAX_BOARDS];
+
+static int read_source_board(int board, monitor_sample_s *sample) {
+	const monitor_source_s *source = current_monitor_source();
+	pthread_mutex_lock(&monitor_source_lock);
+	sample->timestamp   = aocl_utils::getCurrentTimestamp();
+	sample->board       = board;
+	sample->phase       = __atomic_load_n(&monitor_phase, __ATOMIC_ACQUIRE);
+	sample->temperature = 0.0f;
+	sample->power       = 0.0f;
+	const int ret = source->read(source->state, board, sample);
+	if (board >= 0 && board < MONITOR_MAX_BOARDS) {
+		monitor_last[board]       = *sample;
+		monitor_last_valid[board] = ret >= 0;
+	}
+	pthread_mutex_unlock(&monitor_source_lock);
+	if (monitor_record) {
+		monitor_log_record_s record;
+		record.timestamp   = sample->timestamp;
+		record.temperature = sample->temperature;
+		record.power       = sample->power;
+		record.board       = board;
+		pthread_mutex_lock(&monitor_record_lock);
+		if (monitor_record)
+			fwrite(&record, sizeof(record), 1, monitor_record);
+		pthread_mutex_unlock(&monitor_record_lock);
+	}
+	return ret;
+}
+
+int read_monitor_board(int board, monitor_sample_s *sample) {
+	if (!monitor_sampler_running())
+		return read_source_board(board, sample);
+	if (board < 0 || board >= MONITOR_MAX_BOARDS)
+		return -1;
+	pthread_mutex_lock(&monitor_source_lock);
+	const bool valid = monitor_last_valid[board];
+	if (valid)
+		*sample = monitor_last[board];
+	pthread_mutex_unlock(&monitor_source_lock);
+	return valid ? 0 : -1;
+}
+
+int read_monitor(monitor_sample_s *sample) {
+	return read_monitor_board(0, sample);
+}
+
+/**
+  * Samples of a single board keep the original format, with several boards each line names its board.
+  */
+static int format_monitor(char *line, size_t size, const monitor_sample_s *sample) {
+	if (monitor_num_boards() > 1)
+		return snprintf(line, size, "[%f] board=%s, temp=%f, power=%f\n", sample->timestamp, monitor_board_name(sample->board), 
+		                sample->temperature, sample->power);
+	return snprintf(line, size, "[%f] temp=%f, power=%f\n", sample->timestamp, sample->temperature, sample->power);
+}
+
+static int format_monitor_csv(char *line, size_t size, const monitor_sample_s *sample) {
+	return snprintf(line, size, "%.6f,%s,%.3f,%.3f,%s\n", sample->timestamp, monitor_board_name(sample->board), 
+	                sample->temperature, sample->power, monitor_phase_name(sample->phase));
+}
+
+static int write_monitor(FILE *f, const monitor_sample_s *sample) {
+	char line[256];
+	format_monitor(line, sizeof(line), sample);
+	return fputs(line, f);
+}
+
+int print_monitor_board(FILE *f, int board) {
+	monitor_sample_s sample;
+	int ret = 0;
+	for (int i = 0; i < monitor_num_boards(); i++) {
+		if (board != MONITOR_ALL_BOARDS && board != i)
+			continue;
+		if (read_monitor_board(i, &sample) < 0)
+			continue;
+		ret += write_monitor(f, &sample);
+	}
+	return ret;
+}
+
+int print_monitor(FILE *f) {
+	return print_monitor_board(f, MONITOR_ALL_BOARDS);
+}
+
+/**
+  * Background sampler. The sampler thread is the only producer and the writer thread the only 
+  * consumer of the ring, so head and tail need no lock, only acquire/release ordering.
+  */
+static struct {
+	monitor_sample_s ring[MONITOR_RING_DEPTH];
+	unsigned long head;      //Written by the sampler
+	unsigned long tail;      //Written by the writer
+	unsigned long dropped;
+	struct {
+		double timestamp;
+		float  power;
+		double energy;   //Joules since the sampler started
+	} history[MONITOR_HISTORY_DEPTH];
+	unsigned long history_head;
+	float latest[MONITOR_MAX_BOARDS];    //Temperature of the last sample per board
+	int latest_valid[MONITOR_MAX_BOARDS];
+	int running;
+	long period_ns;
+	FILE *f;
+	bool csv;
+	bool close_f;             //The file was opened by start_monitor_csv
+	char buffer[MONITOR_WRITE_BUFFER];
+	pthread_t sampler;
+	pthread_t writer;
+} monitor_sampler;
+
+/**
+  * Appends a sample to the energy history with the running trapezoidal integral of power. Only 
+  * the sampler thread writes the history, readers look at the published entries.
+  */
+static void record_energy(const monitor_sample_s *sample) {
+	unsigned long h = monitor_sampler.history_head;
+	double energy = 0.0;
+	if (h > 0) {
+		const unsigned long prev = (h - 1) & (MONITOR_HISTORY_DEPTH - 1);
+		energy = monitor_sampler.history[prev].energy + (sample->timestamp - monitor_sampler.history[prev].timestamp) * 
+		         0.5 * (sample->power + monitor_sampler.history[prev].power);
+	}
+	monitor_sampler.history[h & (MONITOR_HISTORY_DEPTH - 1)].timestamp = sample->timestamp;
+	monitor_sampler.history[h & (MONITOR_HISTORY_DEPTH - 1)].power     = sample->power;
+	monitor_sampler.history[h & (MONITOR_HISTORY_DEPTH - 1)].energy    = energy;
+	__atomic_store_n(&monitor_sampler.history_head, h + 1, __ATOMIC_RELEASE);
+}
+
+static void *monitor_sampler_thread(void *arg) {
+	struct timespec tick;
+	clock_gettime(CLOCK_MONOTONIC, &tick);
+	while (__atomic_load_n(&monitor_sampler.running, __ATOMIC_ACQUIRE)) {
+		//The energy history holds the power summed over the open boards at the time of the first one
+		monitor_sample_s sample, total;
+		int read = 0;
+		for (int board = 0; board < monitor_num_boards(); board++) {
+			if (read_source_board(board, &sample) < 0) {
+				if (board < MONITOR_MAX_BOARDS)
+					__atomic_store_n(&monitor_sampler.latest_valid[board], 0, __ATOMIC_RELEASE);
+				continue;
+			}
+			if (board < MONITOR_MAX_BOARDS) {
+				__atomic_store(&monitor_sampler.latest[board], &sample.temperature, __ATOMIC_RELAXED);
+				__atomic_store_n(&monitor_sampler.latest_valid[board], 1, __ATOMIC_RELEASE);
+			}
+			if (read++ == 0)
+				total = sample;
+			else
+				total.power += sample.power;
+			unsigned long head = monitor_sampler.head;
+			if (head - __atomic_load_n(&monitor_sampler.tail, __ATOMIC_ACQUIRE) < MONITOR_RING_DEPTH) {
+				monitor_sampler.ring[head & (MONITOR_RING_DEPTH - 1)] = sample;
+				__atomic_store_n(&monitor_sampler.head, head + 1, __ATOMIC_RELEASE);
+			} else {
+				__atomic_add_fetch(&monitor_sampler.dropped, 1, __ATOMIC_RELAXED);
+			}
+		}
+		if (read > 0)
+			record_energy(&total);
+		tick.tv_nsec += monitor_sampler.period_ns;
+		while (tick.tv_nsec >= 1000000000L) {
+			tick.tv_sec++;
+			tick.tv_nsec -= 1000000000L;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tick, NULL) == EINTR)
+			;
+	}
+	return NULL;
+}
+
+static void drain_monitor_ring() {
+	unsigned long tail = monitor_sampler.tail;
+	unsigned long head = __atomic_load_n(&monitor_sampler.head, __ATOMIC_ACQUIRE);
+	size_t used = 0;
+	if (tail == head)
+		return;
+	//Format the whole batch and hand it to the file in as few writes as the buffer allows
+	for (; tail != head; tail++) {
+		const monitor_sample_s *sample = &monitor_sampler.ring[tail & (MONITOR_RING_DEPTH - 1)];
+		char *line = monitor_sampler.buffer + used;
+		const size_t room = MONITOR_WRITE_BUFFER - used;
+		int n = monitor_sampler.csv ? format_monitor_csv(line, room, sample) : format_monitor(line, room, sample);
+		if (n < 0)
+			continue;
+		if ((size_t) n >= room) {
+			fwrite(monitor_sampler.buffer, 1, used, monitor_sampler.f);
+			used = 0;
+			line = monitor_sampler.buffer;
+			n = monitor_sampler.csv ? format_monitor_csv(line, MONITOR_WRITE_BUFFER, sample) : 
+			                          format_monitor(line, MONITOR_WRITE_BUFFER, sample);
+		}
+		used += n;
+	}
+	__atomic_store_n(&monitor_sampler.tail, tail, __ATOMIC_RELEASE);
+	fwrite(monitor_sampler.buffer, 1, used, monitor_sampler.f);
+	fflush(monitor_sampler.f);
+}
+
+static void *monitor_writer_thread(void *arg) {
+	struct timespec pause;
+	pause.tv_sec  = MONITOR_DRAIN_MS / 1000;
+	pause.tv_nsec = (MONITOR_DRAIN_MS % 1000) * 1000000L;
+	while (__atomic_load_n(&monitor_sampler.running, __ATOMIC_ACQUIRE)) {
+		drain_monitor_ring();
+		nanosleep(&pause, NULL);
+	}
+	return NULL;
+}
+
+static int start_sampler(double rate_hz, FILE *f, bool csv, bool close_f) {
+	if (monitor_sampler_running()) {
+		printf("-WARN- Monitor sampler already running\n");
+		return -1;
+	}
+	if (rate_hz < 1.0 || rate_hz > 1000.0) {
+		printf("-WARN- Monitor sample rate %g Hz out of range, clamped to [1, 1000]\n", rate_hz);
+		rate_hz = rate_hz < 1.0 ? 1.0 : 1000.0;
+	}
+	monitor_sampler.head      = 0;
+	monitor_sampler.tail      = 0;
+	monitor_sampler.dropped   = 0;
+	monitor_sampler.history_head = 0;
+	for (int i = 0; i < MONITOR_MAX_BOARDS; i++)
+		monitor_sampler.latest_valid[i] = 0;
+	monitor_sampler.period_ns = (long)(1e9 / rate_hz);
+	monitor_sampler.f         = f;
+	monitor_sampler.csv       = csv;
+	monitor_sampler.close_f   = close_f;
+	__atomic_store_n(&monitor_sampler.running, 1, __ATOMIC_RELEASE);
+	if (pthread_create(&monitor_sampler.sampler, NULL, monitor_sampler_thread, NULL) != 0) {
+		printf("-ERROR- Could not start the monitor sampler thread\n");
+		__atomic_store_n(&monitor_sampler.running, 0, __ATOMIC_RELEASE);
+		return -1;
+	}
+	if (pthread_create(&monitor_sampler.writer, NULL, monitor_writer_thread, NULL) != 0) {
+		printf("-ERROR- Could not start the monitor writer thread\n");
+		__atomic_store_n(&monitor_sampler.running, 0, __ATOMIC_RELEASE);
+		pthread_join(monitor_sampler.sampler, NULL);
+		return -1;
+	}
+	return 0;
+}
+
+int start_monitor_csv(double rate_hz, const char *path) {
+	if (monitor_sampler_running()) {
+		printf("-WARN- Monitor sampler already running\n");
+		return -1;
+	}
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		printf("-ERROR- Could not create monitor log %s\n", path);
+		return -1;
+	}
+	fprintf(f, "timestamp,board,temperature,power,phase\n");
+	if (start_sampler(rate_hz, f, true, true) != 0) {
+		fclose(f);
+		return -1;
+	}
+	return 0;
+}
+
+int start_monitor_sampler(double rate_hz, FILE *f) {
+	const char *csv = getenv("MONITOR_CSV");
+	if (csv != NULL)
+		return start_monitor_csv(rate_hz, csv);
+	return start_sampler(rate_hz, f, false, false);
+}
+
+void stop_monitor_sampler() {
+	if (!monitor_sampler_running())
+		return;
+	__atomic_store_n(&monitor_sampler.running, 0, __ATOMIC_RELEASE);
+	pthread_join(monitor_sampler.sampler, NULL);
+	pthread_join(monitor_sampler.writer, NULL);
+	drain_monitor_ring();
+	if (monitor_sampler.close_f)
+		fclose(monitor_sampler.f);
+	if (monitor_sampler.dropped)
+		printf("-WARN- Monitor sampler dropped %lu samples, the ring was full\n", monitor_sampler.dropped);
+}
+
+bool monitor_sampler_running() {
+	return __atomic_load_n(&monitor_sampler.running, __ATOMIC_ACQUIRE) != 0;
+}
+
+unsigned long monitor_samples_dropped() {
+	return __atomic_load_n(&monitor_sampler.dropped, __ATOMIC_RELAXED);
+}
+
+/**
+  * Energy since the sampler started at time t, interpolating the power linearly between the 
+  * two samples around t. Returns false when t is older than the kept history. The oldest few 
+  * entries are skipped as the sampler may be overwriting them.
+  */
+static bool energy_at(double t, double *energy) {
+	const unsigned long head = __atomic_load_n(&monitor_sampler.history_head, __ATOMIC_ACQUIRE);
+	if (head == 0)
+		return false;
+	const unsigned long guard = 16;
+	unsigned long lo = head > MONITOR_HISTORY_DEPTH - guard ? head - (MONITOR_HISTORY_DEPTH - guard) : 0;
+	unsigned long hi = head - 1;
+#define HISTORY(i) monitor_sampler.history[(i) & (MONITOR_HISTORY_DEPTH - 1)]
+	if (t <= HISTORY(lo).timestamp) {
+		if (lo > 0)
+			return false;
+		*energy = (t - HISTORY(lo).timestamp) * HISTORY(lo).power;
+		return true;
+	}
+	if (t >= HISTORY(hi).timestamp) {
+		*energy = HISTORY(hi).energy + (t - HISTORY(hi).timestamp) * HISTORY(hi).power;
+		return true;
+	}
+	//Last sample at or before t
+	while (hi - lo > 1) {
+		const unsigned long mid = lo + (hi - lo) / 2;
+		if (HISTORY(mid).timestamp <= t)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	const double span  = HISTORY(hi).timestamp - HISTORY(lo).timestamp;
+	const double power = span > 0.0 ? HISTORY(lo).power + (HISTORY(hi).power - HISTORY(lo).power) * (t - HISTORY(lo).timestamp) / span 
+	                                : HISTORY(lo).power;
+	*energy = HISTORY(lo).energy + (t - HISTORY(lo).timestamp) * 0.5 * (HISTORY(lo).power + power);
+#undef HISTORY
+	return true;
+}
+
+double monitor_energy(double t0, double t1) {
+	double e0, e1;
+	if (!energy_at(t0, &e0) || !energy_at(t1, &e1))
+		return -1.0;
+	return e1 - e0;
+}
+
+/* Host time at profiling time 0, set by the clock calibration of init_debug */
+static double profiling_offset       = 0.0;
+static bool   profiling_offset_valid = false;
+
+void set_profiling_offset(double host_at_profiling0) {
+	profiling_offset       = host_at_profiling0;
+	__atomic_store_n(&profiling_offset_valid, true, __ATOMIC_RELEASE);
+}
+
+double profiled_energy(cl_ulong start_ns, cl_ulong end_ns) {
+	static bool warned = false;
+	if (!__atomic_load_n(&profiling_offset_valid, __ATOMIC_ACQUIRE)) {
+		if (!warned) {
+			printf("-WARN- Profiling clock is not calibrated against the host, no energy for profiled commands\n");
+			warned = true;
+		}
+		return -1.0;
+	}
+	return monitor_energy(profiling_offset + start_ns * 1e-9, profiling_offset + end_ns * 1e-9);
+}
+
+double event_energy(cl_event event) {
+	cl_ulong start, end;
+	cl_int status;
+	status  = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	status |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	if (status != CL_SUCCESS)
+		return -1.0;
+	return profiled_energy(start, end);
+}
+
+double events_energy(const cl_event *events, int count) {
+	cl_ulong first = ~(cl_ulong)0, last = 0;
+	for (int i = 0; i < count; i++) {
+		cl_ulong start, end;
+		cl_int status;
+		if (!events[i])
+			continue;
+		status  = clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+		status |= clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+		if (status != CL_SUCCESS)
+			return -1.0;
+		if (start < first)
+			first = start;
+		if (end > last)
+			last = end;
+	}
+	if (last < first)
+		return -1.0;
+	return profiled_energy(first, last);
+}
+
+float monitor_temperature(int board) {
+	if (monitor_sampler_running() && board >= 0 && board < MONITOR_MAX_BOARDS && 
+	    __atomic_load_n(&monitor_sampler.latest_valid[board], __ATOMIC_ACQUIRE)) {
+		float temperature;
+		__atomic_load(&monitor_sampler.latest[board], &temperature, __ATOMIC_RELAXED);
+		return temperature;
+	}
+	//No MMD query on the launch path, the board is unknown until the sampler reads it
+	return NAN;
+}
+
+/**
+  * Weight of a board for thermal_split, 1 below the guard band or unknown down to THERMAL_MIN_SHARE 
+  * at the limit.
+  */
+static double thermal_weight(float temperature) {
+	if (isnan(temperature))
+		return 1.0;
+	const double headroom = (THERMAL_LIMIT_C - temperature) / THERMAL_GUARD_C;
+	if (headroom >= 1.0)
+		return 1.0;
+	return headroom > THERMAL_MIN_SHARE ? headroom : THERMAL_MIN_SHARE;
+}
+
+void thermal_split(int num_boards, unsigned total, unsigned *share) {
+	double weight[MONITOR_MAX_BOARDS];
+	double sum = 0.0;
+	unsigned given = 0;
+	if (num_boards > MONITOR_MAX_BOARDS) {
+		//Too many boards to weigh, split evenly
+		for (int i = 0; i < num_boards; i++)
+			share[i] = total / num_boards + ((unsigned) i < total % num_boards ? 1 : 0);
+		return;
+	}
+	for (int i = 0; i < num_boards; i++) {
+		weight[i] = thermal_weight(monitor_temperature(i));
+		sum += weight[i];
+	}
+	for (int i = 0; i < num_boards; i++) {
+		share[i] = (unsigned) (total * weight[i] / sum);
+		given += share[i];
+	}
+	//Rounding leftovers go to the coolest boards first
+	while (given < total) {
+		int best = 0;
+		for (int i = 1; i < num_boards; i++)
+			if (weight[i] / sum - (double) share[i] / total > weight[best] / sum - (double) share[best] / total)
+				best = i;
+		share[best]++;
+		given++;
+	}
+}
+
+double thermal_pace(int board) {
+	const float temperature = monitor_temperature(board);
+	if (isnan(temperature))
+		return 0.0;
+	const double over = (temperature - (THERMAL_LIMIT_C - THERMAL_GUARD_C)) / THERMAL_GUARD_C;
+	if (over <= 0.0)
+		return 0.0;
+	const double pause = 1e-3 * THERMAL_MAX_PACE_MS * (over < 1.0 ? over : 1.0);
+	struct timespec t;
+	t.tv_sec  = (time_t) pause;
+	t.tv_nsec = (long) ((pause - t.tv_sec) * 1e9);
+	while (nanosleep(&t, &t) == EINTR)
+		;
+	return pause;
+}
+
+void print_energy(FILE *f, double joules, double seconds, double work, const char *unit) {
+	if (joules < 0.0) {
+		fprintf(f, "Energy = n/a, start the monitor sampler to measure it\n");
+		return;
+	}
+	fprintf(f, "Energy = %.4g J, %.4g J / %s", joules, work > 0.0 ? joules / work : 0.0, unit);
+	if (seconds > 0.0)
+		fprintf(f, ", average %.2f W", joules / seconds);
+	fprintf(f, "\n");
+}
+
+/**
+  * Completion state shared between monitor_and_finish and the event callback. The runtime may 
+  * call back after the wait has timed out for good, so whichever side lets go last frees it.
+  */
+struct monitor_wait {
+	pthread_mutex_t lock;
+	pthread_cond_t  done_cond;
+	int done;
+	int refs;
+};
+
+static void release_monitor_wait(struct monitor_wait *w) {
+	pthread_mutex_lock(&w->lock);
+	int refs = --w->refs;
+	pthread_mutex_unlock(&w->lock);
+	if (refs == 0) {
+		pthread_cond_destroy(&w->done_cond);
+		pthread_mutex_destroy(&w->lock);
+		free(w);
+	}
+}
+
+static void CL_CALLBACK monitor_event_complete(cl_event event, cl_int status, void *user_data) {
+	struct monitor_wait *w = (struct monitor_wait *)user_data;
+	pthread_mutex_lock(&w->lock);
+	w->done = 1;
+	pthread_cond_signal(&w->done_cond);
+	pthread_mutex_unlock(&w->lock);
+	release_monitor_wait(w);
 }
 
 /**
   * The function displays the temperature and power values of the FPGA board every 
-  * one second until the execution of the event is complete or fails.
+  * MONITOR_PERIOD_MS until the execution of the event is complete or fails. Completion is 
+  * signalled by an event callback, so the function returns as soon as the event is done 
+  * instead of at the next sample. While the background sampler runs it only waits.
   */
 cl_int monitor_and_finish(cl_command_queue queue, cl_event event, FILE *f) {
 	cl_int ret;
 	size_t retsize;
 	
 	struct timespec tick;
-	int sleep_ret = 0;
 	clock_gettime(CLOCK_REALTIME, &tick);
-	while (1) {
-		if (sleep_ret == 0)
+	const bool sampled = monitor_sampler_running();
+
+	struct monitor_wait *w = (struct monitor_wait *)malloc(sizeof(struct monitor_wait));
+	if (w != NULL) {
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->done_cond, NULL);
+		w->done = 0;
+		w->refs = 2;
+		if (clSetEventCallback(event, CL_COMPLETE, monitor_event_complete, w) != CL_SUCCESS) {
+			w->refs = 1;
+			release_monitor_wait(w);
+			w = NULL;
+		}
+	}
+
+	if (w != NULL) {
+		pthread_mutex_lock(&w->lock);
+		while (!w->done && sampled)
+			pthread_cond_wait(&w->done_cond, &w->lock);
+		while (!w->done) {
+			pthread_mutex_unlock(&w->lock);
 			print_monitor(f);
-		clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &ret, &retsize);
-		if (retsize != sizeof(cl_int) || ret == CL_COMPLETE) {
-			break;
-		} else {
-			if (sleep_ret == 0) {
-				tick.tv_sec++;
+			pthread_mutex_lock(&w->lock);
+			monitor_advance(&tick);
+			while (!w->done && pthread_cond_timedwait(&w->done_cond, &w->lock, &tick) != ETIMEDOUT)
+				;
+		}
+		pthread_mutex_unlock(&w->lock);
+		release_monitor_wait(w);
+	} else {
+		/* No callback, poll the event once per sample */
+		int sleep_ret = 0;
+		while (1) {
+			if (sleep_ret == 0 && !sampled)
+				print_monitor(f);
+			clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &ret, &retsize);
+			if (retsize != sizeof(cl_int) || ret <= CL_COMPLETE) {
+				break;
+			} else {
+				if (sleep_ret == 0) {
+					monitor_advance(&tick);
+				}
+				sleep_ret = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &tick, NULL);
 			}
-			sleep_ret = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &tick, NULL);
 		}
 	}
-	print_monitor(f);
+	if (!sampled)
+		print_monitor(f);
 	return CL_SUCCESS;
 }
 
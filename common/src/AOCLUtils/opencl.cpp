@@ -28,7 +28,11 @@
 #else         // Linux
 #include <stdio.h> 
 #include <unistd.h> // readlink, chdir
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
+#include <vector>
 
 namespace aocl_utils {
 
@@ -370,15 +374,15 @@ cl_program createProgramFromBinary(cl_context context, const char *binary_file_n
     checkError(CL_INVALID_PROGRAM, "Failed to load binary file");
   }
 
-  // Load the binary.
+  // Map the binary, or reuse the mapping of an earlier call.
   size_t binary_size;
-  scoped_array<unsigned char> binary(loadBinaryFile(binary_file_name, &binary_size));
+  const unsigned char *binary = mapBinaryFile(binary_file_name, &binary_size);
   if(binary == NULL) {
     checkError(CL_INVALID_PROGRAM, "Failed to load binary file");
   }
 
   scoped_array<size_t> binary_lengths(num_devices);
-  scoped_array<unsigned char *> binaries(num_devices);
+  scoped_array<const unsigned char *> binaries(num_devices);
   for(unsigned i = 0; i < num_devices; ++i) {
     binary_lengths[i] = binary_size;
     binaries[i] = binary;
@@ -388,7 +392,7 @@ cl_program createProgramFromBinary(cl_context context, const char *binary_file_n
   scoped_array<cl_int> binary_status(num_devices);
 
   cl_program program = clCreateProgramWithBinary(context, num_devices, devices, binary_lengths,
-      (const unsigned char **) binaries.get(), binary_status, &status);
+      binaries.get(), binary_status, &status);
   checkError(status, "Failed to create program with binary");
   for(unsigned i = 0; i < num_devices; ++i) {
     checkError(binary_status[i], "Failed to load binary for device");
@@ -432,6 +436,104 @@ unsigned char *loadBinaryFile(const char *file_name, size_t *size) {
   return binary;
 }
 
+// Binaries handed out by mapBinaryFile, keyed by path. An entry is replaced when the file
+// changes, clCreateProgramWithBinary keeps its own copy so the old mapping can go.
+struct BinaryCacheEntry {
+  std::string path;
+  size_t size;
+#ifdef _WIN32
+  unsigned char *data;
+#else
+  const unsigned char *data;
+  time_t mtime;
+  long mtime_nsec;
+  dev_t dev;
+  ino_t ino;
+#endif
+};
+static std::vector<BinaryCacheEntry> binary_cache;
+
+static void releaseBinaryCacheEntry(BinaryCacheEntry &entry) {
+#ifdef _WIN32
+  delete[] entry.data;
+#else
+  munmap((void *) entry.data, entry.size);
+#endif
+  entry.data = NULL;
+}
+
+const unsigned char *mapBinaryFile(const char *file_name, size_t *size) {
+  unsigned i;
+  for(i = 0; i < binary_cache.size() && binary_cache[i].path != file_name; ++i)
+    ;
+
+#ifdef _WIN32
+  // No mapping, the loaded file is kept instead.
+  if(i == binary_cache.size()) {
+    BinaryCacheEntry entry;
+    entry.path = file_name;
+    entry.data = loadBinaryFile(file_name, &entry.size);
+    if(entry.data == NULL) {
+      return NULL;
+    }
+    binary_cache.push_back(entry);
+  }
+#else
+  struct stat st;
+  if(stat(file_name, &st) != 0) {
+    return NULL;
+  }
+  if(i < binary_cache.size()) {
+    const BinaryCacheEntry &entry = binary_cache[i];
+    if(entry.mtime == st.st_mtim.tv_sec && entry.mtime_nsec == st.st_mtim.tv_nsec && entry.size == (size_t) st.st_size &&
+       entry.dev == st.st_dev && entry.ino == st.st_ino) {
+      *size = entry.size;
+      return entry.data;
+    }
+    // The file changed since it was mapped.
+    releaseBinaryCacheEntry(binary_cache[i]);
+    binary_cache.erase(binary_cache.begin() + i);
+    i = binary_cache.size();
+  }
+
+  int fd = open(file_name, O_RDONLY);
+  if(fd < 0) {
+    return NULL;
+  }
+  if(fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED) {
+    return NULL;
+  }
+  // The whole binary is handed to the runtime, read it ahead.
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  madvise(data, st.st_size, MADV_WILLNEED);
+
+  BinaryCacheEntry entry;
+  entry.path       = file_name;
+  entry.size       = st.st_size;
+  entry.data       = (const unsigned char *) data;
+  entry.mtime      = st.st_mtim.tv_sec;
+  entry.mtime_nsec = st.st_mtim.tv_nsec;
+  entry.dev        = st.st_dev;
+  entry.ino        = st.st_ino;
+  binary_cache.push_back(entry);
+#endif
+  *size = binary_cache[i].size;
+  return binary_cache[i].data;
+}
+
+void releaseBinaryCache() {
+  for(unsigned i = 0; i < binary_cache.size(); ++i) {
+    releaseBinaryCacheEntry(binary_cache[i]);
+  }
+  binary_cache.clear();
+}
+
 bool fileExists(const char *file_name) {
 #ifdef _WIN32 // Windows
   DWORD attrib = GetFileAttributesA(file_name);
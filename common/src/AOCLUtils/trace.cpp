@@ -0,0 +1,147 @@
+#ifndef TRACE_CPP
+#define TRACE_CPP
+
+#include <string.h>
+#include <stdlib.h>
+#include "AOCLUtils/trace.h"
+
+/* Stamps read from the trace file per fread */
+#define TRACE_READ_CHUNK 4096
+
+int read_trace_header(FILE* fp, trace_file_header_s* header) { 
+    if(fread(header,sizeof(trace_file_header_s),1,fp) != 1) { 
+        printf("-ERROR- Could not read trace file header\n");
+        return -1;
+    }
+    if(strncmp(header->magic,TRACE_FILE_MAGIC,sizeof(header->magic)) != 0) { 
+        printf("-ERROR- Not a trace file\n");
+        return -1;
+    }
+    //Version 2 files only lack the payloads
+    if((header->version < 2) | (header->version > TRACE_FILE_VERSION)) { 
+        printf("-ERROR- Unsupported trace file version %u\n", header->version);
+        return -1;
+    }
+    return 0;
+}
+
+long trace_to_chrome_json(const char* trace_file_name
+                         ,const char* json_file_name) { 
+    trace_file_header_s header;
+    FILE*               in;
+    FILE*               out;
+    long                events = 0;
+    uint64_t*           chunk;
+    uint32_t*           values;
+
+    in = fopen(trace_file_name,"rb");
+    if(in == NULL) { 
+        printf("-ERROR- Could not open trace file %s\n", trace_file_name);
+        return -1;
+    }
+    if(read_trace_header(in,&header) != 0) { 
+        fclose(in);
+        return -1;
+    }
+    //Stamps are in cycles, without the clock there is no time axis
+    if(!(header.clock_mhz > 0.0)) { 
+        printf("-ERROR- Trace file %s has no kernel clock\n", trace_file_name);
+        fclose(in);
+        return -1;
+    }
+    out = fopen(json_file_name,"w");
+    if(out == NULL) { 
+        printf("-ERROR- Could not open %s\n", json_file_name);
+        fclose(in);
+        return -1;
+    }
+    setvbuf(out,NULL,_IOFBF,1 << 20);
+    chunk  = (uint64_t *) malloc(sizeof(uint64_t)*TRACE_READ_CHUNK);
+    values = (uint32_t *) malloc(sizeof(uint32_t)*TRACE_READ_CHUNK);
+
+    //Microseconds on the host axis of cycle 0
+    const double base_us = header.host_at_cycle0*1e6;
+
+    fprintf(out,"{\"displayTimeUnit\":\"ns\",\"otherData\":{\"clock_mhz\":%f,\"wall_anchor\":%f,\"host_anchor\":%f,\"host_at_cycle0\":%f},\n"
+                "\"traceEvents\":[\n", header.clock_mhz, header.wall_anchor, header.host_anchor, header.host_at_cycle0);
+
+    const char* sep = "";
+    for(uint32_t p = 0; p < header.num_points; p++) { 
+    trace_point_header_s point;
+    uint64_t             left;
+    uint64_t             prev;
+    uint32_t             prev_value;
+    bool                 have_prev = false;
+    bool                 has_payload;
+    long                 stamp_pos;
+    long                 payload_pos;
+
+        if(fread(&point,sizeof(point),1,in) != 1) { 
+            printf("-ERROR- Truncated trace file %s\n", trace_file_name);
+            break;
+        }
+        fprintf(out,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"trace point %u%s\"}}"
+               ,sep, point.point, point.point, (point.flags & TRACE_POINT_FULL) ? " (full)" : "");
+        sep = ",\n";
+        //An empty point has no payloads to read, whatever its flags say
+        has_payload = (point.flags & TRACE_POINT_PAYLOAD) && (point.count > 0);
+        stamp_pos   = ftell(in);
+        payload_pos = stamp_pos + point.count*sizeof(uint64_t);
+
+        //Each stamp is emitted once the next one is known, the last stamp is an instant event
+        left = point.count;
+        while(left) { 
+        size_t n = left < TRACE_READ_CHUNK ? left : TRACE_READ_CHUNK;
+            if(fread(chunk,sizeof(uint64_t),n,in) != n) { 
+                printf("-ERROR- Truncated trace file %s\n", trace_file_name);
+                left = 0;
+                break;
+            }
+            //Payloads follow all the stamps of the point, fetch the matching chunk
+            if(has_payload) { 
+                stamp_pos = ftell(in);
+                if((fseek(in,payload_pos,SEEK_SET) != 0) || (fread(values,sizeof(uint32_t),n,in) != n)) { 
+                    printf("-ERROR- Truncated trace file %s\n", trace_file_name);
+                    left = 0;
+                    break;
+                }
+                payload_pos += n*sizeof(uint32_t);
+                fseek(in,stamp_pos,SEEK_SET);
+            }
+            for(size_t i = 0; i < n; i++) { 
+                if(have_prev) { 
+                    fprintf(out,",\n{\"name\":\"p%u\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.4f,\"dur\":%.4f"
+                           ,point.point, point.point, base_us + prev/header.clock_mhz, (chunk[i] - prev)/header.clock_mhz);
+                    if(has_payload) 
+                        fprintf(out,",\"args\":{\"value\":%u}",prev_value);
+                    fprintf(out,"}");
+                    events++;
+                }
+                prev       = chunk[i];
+                prev_value = has_payload ? values[i] : 0;
+                have_prev  = true;
+            }
+            left -= n;
+        }
+        if(have_prev) { 
+            fprintf(out,",\n{\"name\":\"p%u\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%.4f"
+                   ,point.point, point.point, base_us + prev/header.clock_mhz);
+            if(has_payload) 
+                fprintf(out,",\"args\":{\"value\":%u}",prev_value);
+            fprintf(out,"}");
+            events++;
+        }
+        if(has_payload) 
+            fseek(in,payload_pos,SEEK_SET);
+    }
+    fprintf(out,"\n]}\n");
+
+    free(chunk);
+    free(values);
+    fclose(in);
+    if(fclose(out) != 0) 
+        return -1;
+    return events;
+}
+
+#endif //TRACE_CPP
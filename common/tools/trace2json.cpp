@@ -0,0 +1,16 @@
+#include <stdio.h>
+#include "AOCLUtils/trace.h"
+
+/* Convert a binary trace file written by write_trace_file to Chrome trace event JSON, 
+ * which can be loaded in chrome://tracing or ui.perfetto.dev */
+int main(int argc, char** argv) { 
+    if(argc != 3) { 
+        printf("Usage: %s <trace file> <json file>\n", argv[0]);
+        return 1;
+    }
+    long events = trace_to_chrome_json(argv[1],argv[2]);
+    if(events < 0) 
+        return 1;
+    printf("-INFO- Wrote %ld events to %s\n", events, argv[2]);
+    return 0;
+}
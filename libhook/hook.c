@@ -1,15 +1,304 @@
 #include <sys/types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <aocl_mmd.h>
 
 #include <dlfcn.h>
 
 /* define a type of function pointer */
 typedef int (*aocl_mmd_open_t) (const char *);
+typedef int (*aocl_mmd_close_t) (int);
+typedef int (*aocl_mmd_read_t) (int, aocl_mmd_op_t, size_t, void *, int, size_t);
+typedef int (*aocl_mmd_write_t) (int, aocl_mmd_op_t, size_t, const void *, int, size_t);
+typedef int (*aocl_mmd_copy_t) (int, aocl_mmd_op_t, size_t, int, size_t, size_t);
+typedef int (*aocl_mmd_set_status_handler_t) (int, aocl_mmd_status_handler_fn, void *);
+
+/* Largest number of boards recorded, further boards are opened but not monitored */
+#define MAX_MMD_BOARDS 16
+#define MMD_BOARD_NAME_LEN 64
 
 int aclnalla_pcie0_handle = -1;
 
+/* Every board opened through aocl_mmd_open, one entry per name in first open order. An entry is 
+ * filled before the count is published, so readers on other threads only see complete entries. 
+ * Reopening a board updates its handle, closing it sets the handle to -1 
+ */
+static struct {
+	char name[MMD_BOARD_NAME_LEN];
+	int  handle;
+} mmd_boards[MAX_MMD_BOARDS];
+static int mmd_num_boards = 0;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of boards opened so far */
+int hook_num_boards()
+{
+	return __atomic_load_n(&mmd_num_boards, __ATOMIC_ACQUIRE);
+}
+
+/* Handle of board i, its name is returned through name. Returns -1 for an unknown or closed board */
+int hook_board(int i, const char **name)
+{
+	if (i < 0 || i >= hook_num_boards())
+		return -1;
+	if (name)
+		*name = mmd_boards[i].name;
+	return __atomic_load_n(&mmd_boards[i].handle, __ATOMIC_ACQUIRE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Transfers on the memory interface are binned by direction and log2 of their size. Latency 
+ * runs from the call to its return for a blocking transfer, to the status handler for one 
+ * with an op. The histograms are printed at exit to the file named by HOOK_DMA_LOG or stderr. 
+ * While running, creating the file named by HOOK_DMA_DUMP prints them on a following transfer 
+ * and removes the file. No signal is used, the board MMD owns SIGUSR1 for its interrupts 
+ *
+ * The MMD calls the status handler from its interrupt signal handler, so completions are 
+ * recorded with atomics only, no lock is taken anywhere on the transfer path 
+ */
+#define DMA_SIZE_BINS 41
+#define DMA_PENDING_OPS 256
+#define DMA_DUMP_POLL_NS 1000000000ull
+
+enum { DMA_READ, DMA_WRITE, DMA_COPY, DMA_DIRECTIONS };
+static const char *dma_direction_names[DMA_DIRECTIONS] = {"read", "write", "copy"};
+
+typedef struct {
+	unsigned long count;
+	unsigned long long bytes;
+	unsigned long long total_ns;
+	unsigned long long min_ns;
+	unsigned long long max_ns;
+} dma_bin_s;
+
+static dma_bin_s dma_bins[DMA_DIRECTIONS][DMA_SIZE_BINS];
+static unsigned long dma_untimed = 0;
+static unsigned long long dma_dump_checked_ns = 0;
+
+/* Transfers with an op in flight, matched by the status handler. A slot goes free -> claimed 
+ * by dma_begin -> ready once filled -> taken by whoever retires it -> free 
+ */
+enum { DMA_SLOT_FREE, DMA_SLOT_CLAIMED, DMA_SLOT_READY, DMA_SLOT_TAKEN };
+
+static struct {
+	int state;
+	aocl_mmd_op_t op;
+	size_t size;
+	int direction;
+	unsigned long long start_ns;
+} dma_pending[DMA_PENDING_OPS];
+
+/* Status handler of the runtime, called after the completion is timed */
+static aocl_mmd_status_handler_fn dma_status_handler_real = NULL;
+
+static unsigned long long dma_now_ns()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (unsigned long long) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static int dma_size_bin(size_t size)
+{
+	int bin = 0;
+	while (size > 1 && bin < DMA_SIZE_BINS - 1) {
+		size >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+/* Async-signal-safe, called from the status handler */
+static void dma_record(int direction, size_t size, unsigned long long ns)
+{
+	dma_bin_s *bin = &dma_bins[direction][dma_size_bin(size)];
+	unsigned long long seen = __atomic_load_n(&bin->min_ns, __ATOMIC_RELAXED);
+	while ((seen == 0 || ns < seen) && 
+	       !__atomic_compare_exchange_n(&bin->min_ns, &seen, ns ? ns : 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	seen = __atomic_load_n(&bin->max_ns, __ATOMIC_RELAXED);
+	while (ns > seen && !__atomic_compare_exchange_n(&bin->max_ns, &seen, ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	__atomic_add_fetch(&bin->bytes, size, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&bin->total_ns, ns, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&bin->count, 1, __ATOMIC_RELEASE);
+}
+
+/* Bins are read one counter at a time, a transfer finishing meanwhile may be partly counted */
+static void dma_dump_to(FILE *f)
+{
+	fprintf(f, "-INFO- MMD transfers : direction, size range, count, bytes, avg/min/max latency (us), MB/s\n");
+	for (int d = 0; d < DMA_DIRECTIONS; d++) {
+		for (int b = 0; b < DMA_SIZE_BINS; b++) {
+			dma_bin_s *bin = &dma_bins[d][b];
+			const unsigned long count = __atomic_load_n(&bin->count, __ATOMIC_ACQUIRE);
+			if (count == 0)
+				continue;
+			const unsigned long long bytes    = __atomic_load_n(&bin->bytes, __ATOMIC_RELAXED);
+			const unsigned long long total_ns = __atomic_load_n(&bin->total_ns, __ATOMIC_RELAXED);
+			fprintf(f, "%-5s [%llu, %llu) %lu %llu %.1f %.1f %.1f %.1f\n", dma_direction_names[d],
+			        b ? 1ull << b : 0ull, 1ull << (b + 1), count, bytes,
+			        1e-3 * total_ns / count, 1e-3 * __atomic_load_n(&bin->min_ns, __ATOMIC_RELAXED), 
+			        1e-3 * __atomic_load_n(&bin->max_ns, __ATOMIC_RELAXED),
+			        total_ns ? 1e3 * bytes / total_ns : 0.0);
+		}
+	}
+	const unsigned long untimed = __atomic_load_n(&dma_untimed, __ATOMIC_RELAXED);
+	if (untimed)
+		fprintf(f, "-WARN- %lu transfers with an op were not timed, more than %d in flight\n", untimed, DMA_PENDING_OPS);
+	fflush(f);
+}
+
+static void dma_dump()
+{
+	const char *path = getenv("HOOK_DMA_LOG");
+	FILE *f = path ? fopen(path, "a") : NULL;
+	dma_dump_to(f ? f : stderr);
+	if (f)
+		fclose(f);
+}
+
+__attribute__((destructor)) static void dma_at_exit()
+{
+	dma_dump();
+}
+
+/* Looks for the HOOK_DMA_DUMP file at most once per DMA_DUMP_POLL_NS */
+static void dma_poll_dump(unsigned long long now_ns)
+{
+	unsigned long long checked = __atomic_load_n(&dma_dump_checked_ns, __ATOMIC_RELAXED);
+	if (now_ns - checked < DMA_DUMP_POLL_NS)
+		return;
+	if (!__atomic_compare_exchange_n(&dma_dump_checked_ns, &checked, now_ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		return;
+	const char *trigger = getenv("HOOK_DMA_DUMP");
+	if (trigger != NULL && unlink(trigger) == 0)
+		dma_dump();
+}
+
+/* A transfer with an op is parked before it is issued, its status handler may run before the 
+ * call returns. Returns the slot, -1 when the transfer is timed on return or -2 when untimed 
+ */
+static int dma_begin(aocl_mmd_op_t op, int direction, size_t size, unsigned long long *start_ns)
+{
+	*start_ns = dma_now_ns();
+	dma_poll_dump(*start_ns);
+	if (op == NULL || dma_status_handler_real == NULL)
+		return -1;
+	for (int slot = 0; slot < DMA_PENDING_OPS; slot++) {
+		int expected = DMA_SLOT_FREE;
+		if (__atomic_compare_exchange_n(&dma_pending[slot].state, &expected, DMA_SLOT_CLAIMED, 0, 
+		                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			dma_pending[slot].op        = op;
+			dma_pending[slot].size      = size;
+			dma_pending[slot].direction = direction;
+			dma_pending[slot].start_ns  = *start_ns;
+			__atomic_store_n(&dma_pending[slot].state, DMA_SLOT_READY, __ATOMIC_RELEASE);
+			return slot;
+		}
+	}
+	__atomic_add_fetch(&dma_untimed, 1, __ATOMIC_RELAXED);
+	return -2;
+}
+
+/* Times a blocking transfer, or drops the parked op of a transfer that failed to issue */
+static void dma_end(int slot, aocl_mmd_op_t op, int direction, size_t size, unsigned long long start_ns, int ret)
+{
+	const unsigned long long end_ns = dma_now_ns();
+	if (slot == -2)
+		return;
+	if (slot >= 0) {
+		int expected = DMA_SLOT_READY;
+		if (ret != 0 && dma_pending[slot].op == op && 
+		    __atomic_compare_exchange_n(&dma_pending[slot].state, &expected, DMA_SLOT_TAKEN, 0, 
+		                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			__atomic_store_n(&dma_pending[slot].state, DMA_SLOT_FREE, __ATOMIC_RELEASE);
+	} else if (ret == 0) {
+		dma_record(direction, size, end_ns - start_ns);
+	}
+}
+
+static void dma_status_handler(int handle, void *user_data, aocl_mmd_op_t op, int status)
+{
+	const unsigned long long end_ns = dma_now_ns();
+	for (int i = 0; i < DMA_PENDING_OPS; i++) {
+		int expected = DMA_SLOT_READY;
+		if (__atomic_load_n(&dma_pending[i].state, __ATOMIC_ACQUIRE) != DMA_SLOT_READY || dma_pending[i].op != op)
+			continue;
+		if (!__atomic_compare_exchange_n(&dma_pending[i].state, &expected, DMA_SLOT_TAKEN, 0, 
+		                                 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			continue;
+		dma_record(dma_pending[i].direction, dma_pending[i].size, end_ns - dma_pending[i].start_ns);
+		__atomic_store_n(&dma_pending[i].state, DMA_SLOT_FREE, __ATOMIC_RELEASE);
+		break;
+	}
+	dma_status_handler_real(handle, user_data, op, status);
+}
+
+AOCL_MMD_CALL int aocl_mmd_set_status_handler(int handle, aocl_mmd_status_handler_fn fn, void *user_data)
+{
+	static aocl_mmd_set_status_handler_t aocl_mmd_set_status_handler_real = NULL;
+	if (!aocl_mmd_set_status_handler_real) {
+		aocl_mmd_set_status_handler_real = (aocl_mmd_set_status_handler_t) dlsym(RTLD_NEXT, "aocl_mmd_set_status_handler");
+	}
+	dma_status_handler_real = fn;
+	return aocl_mmd_set_status_handler_real(handle, fn ? dma_status_handler : NULL, user_data);
+}
+
+AOCL_MMD_CALL int aocl_mmd_read(int handle, aocl_mmd_op_t op, size_t len, void *dst, int mmd_interface, size_t offset)
+{
+	static aocl_mmd_read_t aocl_mmd_read_real = NULL;
+	if (!aocl_mmd_read_real) {
+		aocl_mmd_read_real = (aocl_mmd_read_t) dlsym(RTLD_NEXT, "aocl_mmd_read");
+	}
+	if (mmd_interface != AOCL_MMD_MEMORY)
+		return aocl_mmd_read_real(handle, op, len, dst, mmd_interface, offset);
+	unsigned long long start_ns;
+	int slot = dma_begin(op, DMA_READ, len, &start_ns);
+	int ret = aocl_mmd_read_real(handle, op, len, dst, mmd_interface, offset);
+	dma_end(slot, op, DMA_READ, len, start_ns, ret);
+	return ret;
+}
+
+AOCL_MMD_CALL int aocl_mmd_write(int handle, aocl_mmd_op_t op, size_t len, const void *src, int mmd_interface, size_t offset)
+{
+	static aocl_mmd_write_t aocl_mmd_write_real = NULL;
+	if (!aocl_mmd_write_real) {
+		aocl_mmd_write_real = (aocl_mmd_write_t) dlsym(RTLD_NEXT, "aocl_mmd_write");
+	}
+	if (mmd_interface != AOCL_MMD_MEMORY)
+		return aocl_mmd_write_real(handle, op, len, src, mmd_interface, offset);
+	unsigned long long start_ns;
+	int slot = dma_begin(op, DMA_WRITE, len, &start_ns);
+	int ret = aocl_mmd_write_real(handle, op, len, src, mmd_interface, offset);
+	dma_end(slot, op, DMA_WRITE, len, start_ns, ret);
+	return ret;
+}
+
+AOCL_MMD_CALL int aocl_mmd_copy(int handle, aocl_mmd_op_t op, size_t len, int mmd_interface, size_t src_offset, size_t dst_offset)
+{
+	static aocl_mmd_copy_t aocl_mmd_copy_real = NULL;
+	if (!aocl_mmd_copy_real) {
+		aocl_mmd_copy_real = (aocl_mmd_copy_t) dlsym(RTLD_NEXT, "aocl_mmd_copy");
+	}
+	if (mmd_interface != AOCL_MMD_MEMORY)
+		return aocl_mmd_copy_real(handle, op, len, mmd_interface, src_offset, dst_offset);
+	unsigned long long start_ns;
+	int slot = dma_begin(op, DMA_COPY, len, &start_ns);
+	int ret = aocl_mmd_copy_real(handle, op, len, mmd_interface, src_offset, dst_offset);
+	dma_end(slot, op, DMA_COPY, len, start_ns, ret);
+	return ret;
+}
+
 /* http://optumsoft.com/dangers-of-using-dlsym-with-rtld_next/ is an interesting
  * introduction to the topic.  As mentioned in the post, the idea is to have
  * a function wrapper for the real aocl_mmd_open function. 
@@ -21,10 +310,39 @@ AOCL_MMD_CALL int aocl_mmd_open(const char *name)
     // find the address of the function "aocl_mmd_open"
 		aocl_mmd_open_real = (aocl_mmd_open_t) dlsym(RTLD_NEXT, "aocl_mmd_open");
 	}
-	if (strcmp("aclnalla_pcie0", name) == 0) {
-		aclnalla_pcie0_handle = aocl_mmd_open_real(name);
-		printf("kaicheng: aclnalla_pcie0_handle = %d.\n", aclnalla_pcie0_handle);
-		return aclnalla_pcie0_handle;
+	int handle = aocl_mmd_open_real(name);
+	if (handle < 0)
+		return handle;
+	if (strcmp("aclnalla_pcie0", name) == 0)
+		aclnalla_pcie0_handle = handle;
+
+	int i;
+	for (i = 0; i < mmd_num_boards && strncmp(mmd_boards[i].name, name, MMD_BOARD_NAME_LEN - 1) != 0; i++)
+		;
+	if (i < mmd_num_boards) {
+		__atomic_store_n(&mmd_boards[i].handle, handle, __ATOMIC_RELEASE);
+	} else if (i < MAX_MMD_BOARDS) {
+		strncpy(mmd_boards[i].name, name, MMD_BOARD_NAME_LEN - 1);
+		mmd_boards[i].name[MMD_BOARD_NAME_LEN - 1] = '\0';
+		mmd_boards[i].handle = handle;
+		__atomic_store_n(&mmd_num_boards, i + 1, __ATOMIC_RELEASE);
+	} else {
+		printf("-WARN- %s handle = %d not monitored, more than %d boards\n", name, handle, MAX_MMD_BOARDS);
 	}
-	return aocl_mmd_open_real(name);
+	return handle;
 } 
+
+AOCL_MMD_CALL int aocl_mmd_close(int handle)
+{
+	static aocl_mmd_close_t aocl_mmd_close_real = NULL;
+	if (!aocl_mmd_close_real) {
+		aocl_mmd_close_real = (aocl_mmd_close_t) dlsym(RTLD_NEXT, "aocl_mmd_close");
+	}
+	for (int i = 0; i < hook_num_boards(); i++) {
+		int expected = handle;
+		__atomic_compare_exchange_n(&mmd_boards[i].handle, &expected, -1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	}
+	if (aclnalla_pcie0_handle == handle)
+		aclnalla_pcie0_handle = -1;
+	return aocl_mmd_close_real(handle);
+}
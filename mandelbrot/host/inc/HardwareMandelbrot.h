@@ -44,6 +44,9 @@ int hardwareCalculateFrame(
   double aScale,
   unsigned int* aFrameBuffer);
 
+// Energy of the kernels of the last frame, -1 if unknown
+double hardwareFrameEnergy();
+
 int hardwareRelease();
 
 #endif
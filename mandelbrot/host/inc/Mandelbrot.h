@@ -51,6 +51,11 @@ int mandelbrotCalculateFrame(
   double aScale,
   unsigned int* aFrameBuffer);
 
+// Energy of the last frame, calculated between two host times
+double mandelbrotFrameEnergy(
+  double aStartTime,
+  double aEndTime);
+
 // Release the Mandelbrot resources
 int mandelbrotRelease();
 
@@ -37,6 +37,9 @@ static scoped_array<cl_kernel> theKernels;
 static cl_program theProgram;
 static cl_int theStatus;
 static scoped_array<unsigned> rowsPerDevice;
+// Kernel of each board in the last frame, and the energy over their profiled span
+static scoped_array<cl_event> theKernelEvents;
+static double theFrameEnergy = -1.0;
 
 static scoped_array<cl_mem> thePixelData;
 static unsigned int thePixelDataWidth = 0;
@@ -50,6 +53,8 @@ cl_kernel*        debug_kernel;
 cl_command_queue*  debug_queue;
 stamp_t*           time_stamp;
 watch_s*           watch_points;
+// Debug reset of the previous frame, the next frame's first kernel waits on it
+static cl_event    theResetEvent = NULL;
 std::string imageFilename;
 std::string aocxFilename;
 std::string deviceInfo;
@@ -71,20 +76,15 @@ int hardwareSetFrameBufferSize()
       }
     }
 
-    // Distribute rows evenly across all devices.
+    // Rows are distributed every frame by board temperature, so each buffer can hold all rows.
     rowsPerDevice.reset(numDevices);
-    for(unsigned i = 0; i < numDevices; ++i) {
-      rowsPerDevice[i] = thePixelDataHeight / numDevices;
-      if(i < (thePixelDataHeight % numDevices)) { // for extra rows
-        rowsPerDevice[i]++;
-      }
-    }
+    theKernelEvents.reset(numDevices);
 
     thePixelData.reset(numDevices);
     for(unsigned i = 0; i < numDevices; ++i) {
       // create the input pixel data buffer
       thePixelData[i] = clCreateBuffer(theContext, CL_MEM_WRITE_ONLY, 
-          thePixelDataWidth*rowsPerDevice[i]*sizeof(unsigned int), NULL, &theStatus);
+          thePixelDataWidth*thePixelDataHeight*sizeof(unsigned int), NULL, &theStatus);
       checkError(theStatus, "Failed to create input pixel buffer");
     }
   }
@@ -146,7 +146,7 @@ int hardwareInitialize()
     checkError(theStatus, "Failed to create kernel");
   }
 
-  print_monitor(stdout);
+  start_monitor_sampler(MONITOR_SAMPLE_HZ, stdout);
 
   // init debug
   init_debug(theContext,theProgram,theDevices[0],&debug_kernel,&debug_queue);
@@ -194,12 +194,20 @@ int hardwareCalculateFrame(
   // Make sure width and height match up
   hardwareSetFrameBufferSize();
 
+  // Shift rows away from boards close to their thermal limit
+  thermal_split(numDevices, thePixelDataHeight, rowsPerDevice);
+  set_monitor_phase("hw_mandelbrot_frame");
+  for(unsigned i = 0; i < numDevices; ++i)
+    theKernelEvents[i] = NULL;
+
   unsigned rowOffset = 0;
   for(unsigned i = 0; i < numDevices; rowOffset += rowsPerDevice[i++])
   {
+    if(rowsPerDevice[i] == 0)
+      continue;
+
     // Create ND range size
     size_t globalSize[2] = {thePixelDataWidth, rowsPerDevice[i]};
-    cl_event fevent;
 
     // Set the arguments
     unsigned argi = 0;
@@ -225,12 +233,21 @@ int hardwareCalculateFrame(
     theStatus = clSetKernelArg(theKernels[i], argi++, sizeof(cl_uint), (void*)&theWidth);
     checkError(theStatus, "Failed to set kernel argument %d", argi - 1);
 
-    // Launch kernel
-    theStatus = clEnqueueNDRangeKernel(theQueues[i], theKernels[i], 2, NULL, globalSize, NULL, 0, NULL, &fevent);
+    // Launch kernel, the first one after the debug reset of the last frame
+    theStatus = clEnqueueNDRangeKernel(theQueues[i], theKernels[i], 2, NULL, globalSize, NULL, theResetEvent ? 1 : 0, theResetEvent ? &theResetEvent : NULL, &theKernelEvents[i]);
     checkError(theStatus, "Failed to enqueue kernel");
+    if(theResetEvent) {
+      clReleaseEvent(theResetEvent);
+      theResetEvent = NULL;
+    }
 
-    monitor_and_finish(theQueues[i], fevent, stdout);
+    monitor_and_finish(theQueues[i], theKernelEvents[i], stdout);
   }
+
+  theFrameEnergy = events_energy(theKernelEvents, numDevices);
+  for(unsigned i = 0; i < numDevices; ++i)
+    if(theKernelEvents[i])
+      clReleaseEvent(theKernelEvents[i]);
   
 #if NUM_DEBUG_POINTS > 0
         //Read timer output from device
@@ -239,7 +256,8 @@ int hardwareCalculateFrame(
         printf(" %d\n", NUM_DEBUG_POINTS);
         read_debug_all_buffers(theContext,theProgram,debug_kernel,debug_queue,&time_stamp);
         print_debug(time_stamp);
-        reset_debug_all_buffers(debug_kernel,debug_queue);
+        //Reset for the next frame without waiting on the debug queue
+        theResetEvent = control_buffers_async(debug_kernel,debug_queue,DEBUG_POINTS_MASK,D_RESET,0,NULL);
 #endif //NUM_DEBUG_POINTS
 
 #if NUM_WATCH_POINTS > 0
@@ -251,6 +269,8 @@ int hardwareCalculateFrame(
   rowOffset = 0;
   for(unsigned i = 0; i < numDevices; rowOffset += rowsPerDevice[i++])
   {
+    if(rowsPerDevice[i] == 0)
+      continue;
 //    printf("[%f] read buffer start.\n", getCurrentTimestamp());
     // Read the output
     theStatus = clEnqueueReadBuffer(theQueues[i], thePixelData[i], CL_FALSE, 0, thePixelDataWidth*rowsPerDevice[i]*sizeof(unsigned int), &aFrameBuffer[rowOffset * theWidth], 0, NULL, &event);
@@ -258,16 +278,26 @@ int hardwareCalculateFrame(
     monitor_and_finish(theQueues[i], event, stdout);
 //    printf("[%f] read buffer end.\n", getCurrentTimestamp());
   }
+  set_monitor_phase(NULL);
 
   // Return success
   return 0;
 }
 
 
+double hardwareFrameEnergy()
+{
+  return theFrameEnergy;
+}
+
 // free memory allocated by the program
 int hardwareRelease()
 {
+  stop_monitor_sampler();
+
   // Release all created objects
+  if(theResetEvent)
+    clReleaseEvent(theResetEvent);
   for(unsigned i = 0; i < numDevices; ++i)
   {
     if(theKernels && theKernels[i]) 
@@ -77,6 +77,18 @@ int mandelbrotCalculateFrame(
   return 0;
 }
 
+// Energy of the last frame, the profiled kernels in hardware and the host window in software
+double mandelbrotFrameEnergy(
+  double aStartTime,
+  double aEndTime)
+{
+  if(theCalculationMethod == HARDWARE)
+    return hardwareFrameEnergy();
+
+  else
+    return monitor_energy(aStartTime, aEndTime);
+}
+
 // Release the Mandelbrot resources
 int mandelbrotRelease()
 {
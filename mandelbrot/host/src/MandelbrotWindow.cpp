@@ -63,6 +63,7 @@ extern unsigned testFrameCount;
 extern unsigned testFrameDump;
 unsigned testCurFrameCount = 0;
 double total_elapsed_time = 0;
+double total_energy = 0;
 
 
 void mandelbrotWindowRepaint();
@@ -74,6 +75,7 @@ int mandelbrotWindowInitialize(
   unsigned int aHeight)
 {
   total_elapsed_time = 0;
+  total_energy = 0;
   // Start the mandelbrot
   mandelbrotInitialize();
 
@@ -220,6 +222,8 @@ int mandelbrotWindowUpdate()
   const double end_time = getCurrentTimestamp();
   const double elapsed_time = end_time - start_time;
   total_elapsed_time += elapsed_time;
+  const double energy = mandelbrotFrameEnergy(start_time, end_time);
+  total_energy = (energy < 0 || total_energy < 0) ? -1.0 : total_energy + energy;
 
   // Output FPS
   char title[256];
@@ -349,6 +353,7 @@ int mandelbrotWindowMainLoop()
 
   printf("Total Time(sec) = %.4f\n", (float)(total_elapsed_time));
   printf("Total elapsed time: %f sec.\nAverage FPS: %f.\n", total_elapsed_time, testFrameCount / total_elapsed_time);
+  print_energy(stdout, total_energy, total_elapsed_time, testFrameCount, "frame");
 
   // return success
   return 0;
@@ -128,6 +128,9 @@ void test(long N, long M) {
 	//Read timer output from device
 	read_debug_all_buffers(context,program,debug_kernel,debug_queue,&time_stamp);
         print_debug(time_stamp);
+        trace_stats_s trace_stats[NUM_DEBUG_POINTS];
+        analyze_trace(time_stamp,0,trace_stats);
+        print_trace_stats(trace_stats,NUM_DEBUG_POINTS,stdout);
         reset_debug_all_buffers(debug_kernel,debug_queue);
 #endif //NUM_DEBUG_POINTS
   printf("\nVerifying\n");
@@ -41,6 +41,7 @@ float fZoom = 1024;
 bool useFilter = false;
 unsigned int thresh = 128;
 float fps_raw = 0;
+double totalEnergy = 0;
 
 cl_uint *input = NULL;
 cl_uint *output = NULL;
@@ -62,6 +63,8 @@ cl_kernel*        debug_kernel;
 cl_command_queue*  debug_queue;
 stamp_t*           time_stamp;
 watch_s*           watch_points;
+// Debug reset of the previous frame, the next frame's first enqueue waits on it
+static cl_event    reset_event = NULL;
 std::string imageFilename;
 std::string aocxFilename;
 std::string deviceInfo;
@@ -122,8 +125,13 @@ void filter()
   double dstart = getCurrentTimestamp();
 #if USE_SVM_API == 0
   printf("[%f] write buffer start.\n", getCurrentTimestamp());
-  status = clEnqueueWriteBuffer(queue, in_buffer, CL_FALSE, 0, sizeof(unsigned int) * ROWS * COLS, input, 0, NULL, &event);
+  set_monitor_phase("write_buffer");
+  status = clEnqueueWriteBuffer(queue, in_buffer, CL_FALSE, 0, sizeof(unsigned int) * ROWS * COLS, input, reset_event ? 1 : 0, reset_event ? &reset_event : NULL, &event);
   checkError(status, "Error: could not copy data into device");
+  if (reset_event) {
+    clReleaseEvent(reset_event);
+    reset_event = NULL;
+  }
   clFlush(queue);
   monitor_and_finish(queue, event, stdout);
   printf("[%f] write buffer end.\n", getCurrentTimestamp());
@@ -141,8 +149,13 @@ void filter()
   checkError(status, "Error: could not set sobel threshold");
 
   
-  status = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &sobelSize, &sobelSize, 0, NULL, &event);
+  set_monitor_phase("sobel");
+  status = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &sobelSize, &sobelSize, reset_event ? 1 : 0, reset_event ? &reset_event : NULL, &event);
   checkError(status, "Error: could not enqueue sobel filter");
+  if (reset_event) {
+    clReleaseEvent(reset_event);
+    reset_event = NULL;
+  }
  // clFlush(queue);
   monitor_and_finish(queue, event, stdout);
 //  status  = clFinish(queue);
@@ -161,7 +174,8 @@ void filter()
         printf(" %d\n", NUM_DEBUG_POINTS);
         read_debug_all_buffers(context,program,debug_kernel,debug_queue,&time_stamp);
         print_debug(time_stamp);
-        reset_debug_all_buffers(debug_kernel,debug_queue);
+        //Reset for the next frame without waiting on the debug queue
+        reset_event = control_buffers_async(debug_kernel,debug_queue,DEBUG_POINTS_MASK,D_RESET,0,NULL);
 #endif //NUM_DEBUG_POINTS
 
 #if NUM_WATCH_POINTS > 0
@@ -172,9 +186,11 @@ void filter()
   fps_raw = (1.0f / ((end - start) * 1e-9f));
   if (profile) {
     printf("Throughput: %f FPS\n", fps_raw);
+    print_energy(stdout, profiled_energy(start, end), (end - start) * 1e-9, 1, "frame");
   }
 #if USE_SVM_API == 0
   printf("[%f] read buffer start.\n", getCurrentTimestamp());
+  set_monitor_phase("read_buffer");
   status = clEnqueueReadBuffer(queue, out_buffer, CL_FALSE, 0, sizeof(unsigned int) * ROWS * COLS, output, 0, NULL, &event);
   checkError(status, "Error: could not copy data from device");
   clFlush(queue);
@@ -189,7 +205,10 @@ void filter()
   checkError(status, "Failed to map output");
 #endif /* USE_SVM_API == 0 */
   double dend = getCurrentTimestamp();
+  set_monitor_phase(NULL);
   elapsedTime += dend - dstart;
+  double frameEnergy = monitor_energy(dstart, dend);
+  totalEnergy = (frameEnergy < 0 || totalEnergy < 0) ? -1.0 : totalEnergy + frameEnergy;
 
   if(testMode) {
     // Dump out frame data in PPM (ASCII).
@@ -203,6 +222,7 @@ void filter()
       quitEvent.type = SDL_QUIT;
       SDL_PushEvent(&quitEvent);
       printf("Total Time(sec): %.4f\n", elapsedTime);
+      print_energy(stdout, totalEnergy, elapsedTime, nTest, "frame");
     }
   }
 
@@ -273,6 +293,7 @@ int main(int argc, char **argv)
   initCL();
   // init debug
   init_debug(context,program,device,&debug_kernel,&debug_queue);
+  start_monitor_sampler(MONITOR_SAMPLE_HZ, stdout);
 
 #if USE_SVM_API == 1
   status = clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_WRITE,
@@ -532,11 +553,13 @@ void teardown(int exit_status)
   if (input) clSVMFree(context, input);
   if (output) clSVMFree(context, output);
 #endif /* USE_SVM_API == 0 */
+  if (reset_event) clReleaseEvent(reset_event);
   if (kernel) clReleaseKernel(kernel);
   if (program) clReleaseProgram(program);
   if (queue) clReleaseCommandQueue(queue);
   if (context) clReleaseContext(context);
 
+  stop_monitor_sampler();
   SDL_Quit();
   exit(exit_status);
 }